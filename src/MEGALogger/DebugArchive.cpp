@@ -0,0 +1,451 @@
+#include "DebugArchive.h"
+#include <QDataStream>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+
+#define ARCHIVE_MAGIC "MLA1"
+#define BLOCK_MAGIC 0x4d4c424b  // MLBK
+#define INDEX_MAGIC 0x4d4c4958  // MLIX
+#define RECORDS_PER_BLOCK 4096
+#define MAX_CACHED_BLOCKS 16
+// size of a block header: magic, numRecords, firstTime, lastTime, compressedSize
+#define BLOCK_HEADER_SIZE (4 + 4 + 8 + 8 + 4)
+// size of the trailer: index offset, magic
+#define TRAILER_SIZE (8 + 4)
+
+DebugArchiveWriter::DebugArchiveWriter()
+{
+    blockRecords = 0;
+    blockFirstTime = 0;
+    blockLastTime = 0;
+    numRecords = 0;
+}
+
+DebugArchiveWriter::~DebugArchiveWriter()
+{
+    close();
+}
+
+bool DebugArchiveWriter::open(const QString &path)
+{
+    close();
+
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    blocks.clear();
+    blockData.clear();
+    blockRecords = 0;
+    numRecords = 0;
+    return file.write(ARCHIVE_MAGIC, strlen(ARCHIVE_MAGIC)) == (qint64)strlen(ARCHIVE_MAGIC);
+}
+
+bool DebugArchiveWriter::isOpen() const
+{
+    return file.isOpen();
+}
+
+bool DebugArchiveWriter::addRow(const DebugRow &row)
+{
+    if (!file.isOpen())
+    {
+        return false;
+    }
+
+    QDataStream out(&blockData, QIODevice::WriteOnly | QIODevice::Append);
+    out.setVersion(QDataStream::Qt_4_8);
+    out << row.time << row.timeStamp << row.messageType << row.content;
+
+    if (!blockRecords)
+    {
+        blockFirstTime = row.time;
+    }
+    blockLastTime = row.time;
+    blockRecords++;
+
+    if (blockRecords >= RECORDS_PER_BLOCK)
+    {
+        return writeBlock();
+    }
+    return true;
+}
+
+bool DebugArchiveWriter::writeBlock()
+{
+    if (!blockRecords)
+    {
+        return true;
+    }
+
+    QByteArray compressed = qCompress(blockData);
+
+    DebugArchiveBlock block;
+    block.compressedSize = compressed.size();
+    block.numRecords = blockRecords;
+    block.firstRecord = numRecords;
+    block.firstTime = blockFirstTime;
+    block.lastTime = blockLastTime;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_4_8);
+    out << (quint32)BLOCK_MAGIC << block.numRecords << block.firstTime << block.lastTime << block.compressedSize;
+    block.offset = file.pos();
+    out.writeRawData(compressed.constData(), compressed.size());
+
+    blocks.append(block);
+    numRecords += blockRecords;
+    blockData.clear();
+    blockRecords = 0;
+
+    // a capture can be interrupted at any moment, keep complete blocks on disk
+    file.flush();
+    return out.status() == QDataStream::Ok;
+}
+
+bool DebugArchiveWriter::close()
+{
+    if (!file.isOpen())
+    {
+        return true;
+    }
+
+    bool ok = writeBlock();
+
+    qint64 indexOffset = file.pos();
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_4_8);
+    out << (quint32)INDEX_MAGIC << (quint32)blocks.size();
+    for (int i = 0; i < blocks.size(); i++)
+    {
+        const DebugArchiveBlock &block = blocks.at(i);
+        out << block.offset << block.compressedSize << block.numRecords
+            << block.firstTime << block.lastTime;
+    }
+    out << indexOffset << (quint32)INDEX_MAGIC;
+    ok = ok && out.status() == QDataStream::Ok;
+
+    file.close();
+    blocks.clear();
+    return ok;
+}
+
+DebugArchiveReader::DebugArchiveReader()
+{
+    totalRecords = 0;
+    blockCache.setMaxCost(MAX_CACHED_BLOCKS);
+}
+
+bool DebugArchiveReader::isArchive(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    return file.read(strlen(ARCHIVE_MAGIC)) == ARCHIVE_MAGIC;
+}
+
+bool DebugArchiveReader::open(const QString &path)
+{
+    file.close();
+    file.setFileName(path);
+    blocks.clear();
+    blockCache.clear();
+    totalRecords = 0;
+
+    if (!file.open(QIODevice::ReadOnly) || file.read(strlen(ARCHIVE_MAGIC)) != ARCHIVE_MAGIC)
+    {
+        return false;
+    }
+
+    if (!readIndex() && !scanBlocks())
+    {
+        return false;
+    }
+
+    for (int i = 0; i < blocks.size(); i++)
+    {
+        blocks[i].firstRecord = totalRecords;
+        totalRecords += blocks.at(i).numRecords;
+    }
+    return true;
+}
+
+bool DebugArchiveReader::readIndex()
+{
+    qint64 size = file.size();
+    if (size < (qint64)strlen(ARCHIVE_MAGIC) + TRAILER_SIZE || !file.seek(size - TRAILER_SIZE))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_8);
+    qint64 indexOffset;
+    quint32 magic;
+    in >> indexOffset >> magic;
+    if (in.status() != QDataStream::Ok || magic != INDEX_MAGIC
+            || indexOffset < (qint64)strlen(ARCHIVE_MAGIC) || indexOffset >= size
+            || !file.seek(indexOffset))
+    {
+        return false;
+    }
+
+    quint32 numBlocks;
+    in >> magic >> numBlocks;
+    if (in.status() != QDataStream::Ok || magic != INDEX_MAGIC)
+    {
+        return false;
+    }
+
+    QVector<DebugArchiveBlock> index;
+    for (quint32 i = 0; i < numBlocks; i++)
+    {
+        DebugArchiveBlock block;
+        in >> block.offset >> block.compressedSize >> block.numRecords
+           >> block.firstTime >> block.lastTime;
+        if (in.status() != QDataStream::Ok
+                || block.offset + block.compressedSize > indexOffset)
+        {
+            return false;
+        }
+        block.firstRecord = 0;
+        index.append(block);
+    }
+
+    blocks = index;
+    return true;
+}
+
+// used when the index is missing, only the block headers are read
+bool DebugArchiveReader::scanBlocks()
+{
+    blocks.clear();
+    qint64 size = file.size();
+    qint64 pos = strlen(ARCHIVE_MAGIC);
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_8);
+    while (pos + BLOCK_HEADER_SIZE <= size && file.seek(pos))
+    {
+        quint32 magic;
+        DebugArchiveBlock block;
+        in >> magic >> block.numRecords >> block.firstTime >> block.lastTime >> block.compressedSize;
+        block.offset = pos + BLOCK_HEADER_SIZE;
+        block.firstRecord = 0;
+        if (in.status() != QDataStream::Ok || magic != BLOCK_MAGIC
+                || block.offset + block.compressedSize > size)
+        {
+            // end of the file or an incomplete block
+            break;
+        }
+
+        blocks.append(block);
+        pos = block.offset + block.compressedSize;
+    }
+
+    return true;
+}
+
+QString DebugArchiveReader::fileName() const
+{
+    return file.fileName();
+}
+
+qint64 DebugArchiveReader::numRecords() const
+{
+    return totalRecords;
+}
+
+int DebugArchiveReader::numBlocks() const
+{
+    return blocks.size();
+}
+
+int DebugArchiveReader::blockOf(qint64 record) const
+{
+    int low = 0;
+    int high = blocks.size() - 1;
+    while (low < high)
+    {
+        int mid = (low + high + 1) / 2;
+        if (blocks.at(mid).firstRecord <= record)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
+
+const DebugArchiveBlock &DebugArchiveReader::blockInfo(int block) const
+{
+    return blocks.at(block);
+}
+
+bool DebugArchiveReader::readBlock(int block, QVector<DebugRow> &rows)
+{
+    const DebugArchiveBlock &info = blocks.at(block);
+    if (!file.seek(info.offset))
+    {
+        return false;
+    }
+
+    QByteArray data = qUncompress(file.read(info.compressedSize));
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_4_8);
+
+    rows.resize(info.numRecords);
+    for (quint32 i = 0; i < info.numRecords; i++)
+    {
+        DebugRow &row = rows[i];
+        in >> row.time >> row.timeStamp >> row.messageType >> row.content;
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+DebugRow DebugArchiveReader::record(qint64 record)
+{
+    if (record < 0 || record >= totalRecords)
+    {
+        return DebugRow();
+    }
+
+    int block = blockOf(record);
+    QVector<DebugRow> *rows = blockCache.object(block);
+    if (!rows)
+    {
+        rows = new QVector<DebugRow>();
+        readBlock(block, *rows);
+        blockCache.insert(block, rows);
+    }
+
+    int i = int(record - blocks.at(block).firstRecord);
+    return (i < rows->size()) ? rows->at(i) : DebugRow();
+}
+
+qint64 DebugArchiveReader::findTime(qint64 time)
+{
+    for (int block = 0; block < blocks.size(); block++)
+    {
+        const DebugArchiveBlock &info = blocks.at(block);
+        if (info.lastTime < time)
+        {
+            continue;
+        }
+
+        // only this block has to be decompressed
+        for (quint32 i = 0; i < info.numRecords; i++)
+        {
+            qint64 r = info.firstRecord + i;
+            if (record(r).time >= time)
+            {
+                return r;
+            }
+        }
+    }
+    return -1;
+}
+
+DebugArchiveModel::DebugArchiveModel(DebugArchiveReader *reader, QObject *parent) :
+    QAbstractTableModel(parent)
+{
+    this->reader = reader;
+    filterActive = false;
+}
+
+DebugArchiveModel::~DebugArchiveModel()
+{
+    delete reader;
+}
+
+DebugArchiveReader *DebugArchiveModel::archiveReader() const
+{
+    return reader;
+}
+
+int DebugArchiveModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+    {
+        return 0;
+    }
+    return filterActive ? visible.size() : int(qMin(reader->numRecords(), (qint64)INT_MAX));
+}
+
+int DebugArchiveModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+    {
+        return 0;
+    }
+    return DebugLogModel::NUM_COLUMNS;
+}
+
+QVariant DebugArchiveModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || role != Qt::DisplayRole || index.row() >= rowCount())
+    {
+        return QVariant();
+    }
+
+    DebugRow row = reader->record(filterActive ? visible.at(index.row()) : index.row());
+    return DebugLogModel::columnValue(row, index.column());
+}
+
+QVariant DebugArchiveModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+    return DebugLogModel::columnName(section);
+}
+
+void DebugArchiveModel::setFilter(const QRegExp &regExp, int column)
+{
+    beginResetModel();
+    filterActive = !regExp.isEmpty();
+    visible.clear();
+    if (filterActive)
+    {
+        QVector<DebugRow> rows;
+        for (int block = 0; block < reader->numBlocks(); block++)
+        {
+            if (!reader->readBlock(block, rows))
+            {
+                continue;
+            }
+
+            qint64 firstRecord = reader->blockInfo(block).firstRecord;
+            for (int i = 0; i < rows.size(); i++)
+            {
+                if (DebugLogModel::columnValue(rows.at(i), column).contains(regExp))
+                {
+                    visible.append(firstRecord + i);
+                }
+            }
+        }
+    }
+    endResetModel();
+}
+
+int DebugArchiveModel::rowForTime(qint64 time) const
+{
+    qint64 record = reader->findTime(time);
+    if (record < 0 || !filterActive)
+    {
+        return int(record);
+    }
+
+    // first visible message after that one
+    QVector<qint64>::const_iterator it = std::lower_bound(visible.constBegin(), visible.constEnd(), record);
+    return (it == visible.constEnd()) ? -1 : int(it - visible.constBegin());
+}
@@ -0,0 +1,114 @@
+#ifndef DEBUGARCHIVE_H
+#define DEBUGARCHIVE_H
+
+#include <QFile>
+#include <QVector>
+#include <QList>
+#include <QCache>
+#include <QAbstractTableModel>
+#include <QRegExp>
+
+#include "DebugLogModel.h"
+
+/*
+ * Log archive made of independently compressed blocks.
+ *
+ * "MLA1", then blocks of up to RECORDS_PER_BLOCK messages, each one preceded by
+ * a header with its number of messages, the time range and the compressed size.
+ * Closing the archive appends an index with the position of every block and the
+ * offset of that index. Archives without an index (capture interrupted) are opened
+ * by walking the block headers.
+ */
+struct DebugArchiveBlock
+{
+    qint64 offset; // position of the compressed data
+    quint32 compressedSize;
+    quint32 numRecords;
+    qint64 firstRecord;
+    qint64 firstTime;
+    qint64 lastTime;
+};
+
+class DebugArchiveWriter
+{
+public:
+    DebugArchiveWriter();
+    ~DebugArchiveWriter();
+
+    bool open(const QString &path);
+    bool isOpen() const;
+    bool addRow(const DebugRow &row);
+    // writes the pending messages and the index
+    bool close();
+
+private:
+    bool writeBlock();
+
+    QFile file;
+    QByteArray blockData;
+    quint32 blockRecords;
+    qint64 blockFirstTime;
+    qint64 blockLastTime;
+    qint64 numRecords;
+    QList<DebugArchiveBlock> blocks;
+};
+
+class DebugArchiveReader
+{
+public:
+    DebugArchiveReader();
+
+    static bool isArchive(const QString &path);
+
+    bool open(const QString &path);
+    QString fileName() const;
+    qint64 numRecords() const;
+    int numBlocks() const;
+    int blockOf(qint64 record) const;
+    const DebugArchiveBlock &blockInfo(int block) const;
+
+    // decompressed blocks are cached, only the ones being used stay in memory
+    DebugRow record(qint64 record);
+    bool readBlock(int block, QVector<DebugRow> &rows);
+
+    // first message at or after time (ms since epoch), -1 if there isn't any
+    qint64 findTime(qint64 time);
+
+private:
+    bool readIndex();
+    bool scanBlocks();
+
+    QFile file;
+    QVector<DebugArchiveBlock> blocks;
+    qint64 totalRecords;
+    QCache<int, QVector<DebugRow> > blockCache;
+};
+
+// Read-only view of an archive, the blocks are loaded when their rows are shown
+class DebugArchiveModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit DebugArchiveModel(DebugArchiveReader *reader, QObject *parent = 0);
+    ~DebugArchiveModel();
+
+    DebugArchiveReader *archiveReader() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    // walks the archive block by block, keeping only the positions of the matches
+    void setFilter(const QRegExp &regExp, int column);
+    // row of the first message at or after time, -1 if there isn't any
+    int rowForTime(qint64 time) const;
+
+private:
+    DebugArchiveReader *reader;
+    bool filterActive;
+    QVector<qint64> visible;
+};
+
+#endif // DEBUGARCHIVE_H
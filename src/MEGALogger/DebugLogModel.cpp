@@ -0,0 +1,331 @@
+#include "DebugLogModel.h"
+
+DebugLogModel::DebugLogModel(int capacity, QObject *parent) :
+    QAbstractTableModel(parent)
+{
+    records.resize(qMax(capacity, 1));
+    firstSeq = 0;
+    count = 0;
+    filterActive = false;
+    filterColumn = COLUMN_CONTENT;
+}
+
+QString DebugLogModel::columnName(int column)
+{
+    switch (column)
+    {
+        case COLUMN_TIMESTAMP:
+            return QString::fromUtf8("Timestamp");
+        case COLUMN_TYPE:
+            return QString::fromUtf8("Message Type");
+        case COLUMN_CONTENT:
+            return QString::fromUtf8("Message");
+        default:
+            return QString();
+    }
+}
+
+QString DebugLogModel::columnValue(const DebugRow &row, int column)
+{
+    switch (column)
+    {
+        case COLUMN_TIMESTAMP:
+            return row.timeStamp;
+        case COLUMN_TYPE:
+            return row.messageType;
+        case COLUMN_CONTENT:
+            return row.content;
+        default:
+            return QString();
+    }
+}
+
+int DebugLogModel::capacity() const
+{
+    return records.size();
+}
+
+void DebugLogModel::setCapacity(int capacity)
+{
+    capacity = qMax(capacity, 1);
+    if (capacity == records.size())
+    {
+        return;
+    }
+
+    beginResetModel();
+    int kept = qMin(count, capacity);
+    QVector<Record> newRecords(capacity);
+    for (int i = 0; i < kept; i++)
+    {
+        newRecords[i] = recordAt(firstSeq + count - kept + i);
+    }
+    records = newRecords;
+    firstSeq = 0;
+    count = kept;
+
+    visible.clear();
+    if (filterActive)
+    {
+        for (qint64 seq = 0; seq < count; seq++)
+        {
+            if (matches(recordAt(seq)))
+            {
+                visible.append(seq);
+            }
+        }
+    }
+    endResetModel();
+}
+
+int DebugLogModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+    {
+        return 0;
+    }
+    return filterActive ? visible.size() : count;
+}
+
+int DebugLogModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+    {
+        return 0;
+    }
+    return NUM_COLUMNS;
+}
+
+QVariant DebugLogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || role != Qt::DisplayRole || index.row() >= rowCount())
+    {
+        return QVariant();
+    }
+
+    const Record &r = recordAt(seqAtRow(index.row()));
+    switch (index.column())
+    {
+        case COLUMN_TIMESTAMP:
+            return r.timeStamp;
+        case COLUMN_TYPE:
+            return types.at(r.type);
+        case COLUMN_CONTENT:
+            return r.content;
+        default:
+            return QVariant();
+    }
+}
+
+QVariant DebugLogModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+    return columnName(section);
+}
+
+void DebugLogModel::appendRows(const QList<DebugRow> &rows)
+{
+    if (rows.isEmpty())
+    {
+        return;
+    }
+
+    // only the newest messages fit
+    int first = qMax(0, rows.size() - records.size());
+    int numRows = rows.size() - first;
+    int overflow = count + numRows - records.size();
+    if (overflow > 0)
+    {
+        dropOldest(overflow);
+    }
+
+    if (!filterActive)
+    {
+        beginInsertRows(QModelIndex(), count, count + numRows - 1);
+    }
+
+    QList<qint64> matching;
+    for (int i = first; i < rows.size(); i++)
+    {
+        const DebugRow &row = rows.at(i);
+        qint64 seq = firstSeq + count;
+        Record &r = recordAt(seq);
+        r.time = row.time;
+        r.timeStamp = row.timeStamp;
+        r.type = internType(row.messageType);
+        r.content = row.content;
+        count++;
+
+        if (filterActive && matches(r))
+        {
+            matching.append(seq);
+        }
+    }
+
+    if (!filterActive)
+    {
+        endInsertRows();
+    }
+    else if (matching.size())
+    {
+        beginInsertRows(QModelIndex(), visible.size(), visible.size() + matching.size() - 1);
+        visible.append(matching);
+        endInsertRows();
+    }
+}
+
+void DebugLogModel::clear()
+{
+    beginResetModel();
+    for (int i = 0; i < records.size(); i++)
+    {
+        records[i] = Record();
+    }
+    firstSeq = 0;
+    count = 0;
+    visible.clear();
+    endResetModel();
+}
+
+int DebugLogModel::numRecords() const
+{
+    return count;
+}
+
+DebugRow DebugLogModel::record(int i) const
+{
+    const Record &r = recordAt(firstSeq + i);
+    DebugRow row;
+    row.time = r.time;
+    row.timeStamp = r.timeStamp;
+    row.messageType = types.at(r.type);
+    row.content = r.content;
+    return row;
+}
+
+void DebugLogModel::setFilter(const QRegExp &regExp, int column)
+{
+    beginResetModel();
+    filterActive = !regExp.isEmpty();
+    filterRegExp = regExp;
+    filterColumn = column;
+
+    visible.clear();
+    if (filterActive)
+    {
+        for (qint64 seq = firstSeq; seq < firstSeq + count; seq++)
+        {
+            if (matches(recordAt(seq)))
+            {
+                visible.append(seq);
+            }
+        }
+    }
+    endResetModel();
+}
+
+int DebugLogModel::rowForTime(qint64 time) const
+{
+    // messages are stored in arrival order, so their times are sorted
+    int low = 0;
+    int high = rowCount();
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        if (recordAt(seqAtRow(mid)).time < time)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return (low < rowCount()) ? low : -1;
+}
+
+DebugLogModel::Record &DebugLogModel::recordAt(qint64 seq)
+{
+    return records[int(seq % records.size())];
+}
+
+const DebugLogModel::Record &DebugLogModel::recordAt(qint64 seq) const
+{
+    return records.at(int(seq % records.size()));
+}
+
+qint64 DebugLogModel::seqAtRow(int row) const
+{
+    return filterActive ? visible.at(row) : firstSeq + row;
+}
+
+int DebugLogModel::internType(const QString &type)
+{
+    QHash<QString, int>::const_iterator it = typeIds.constFind(type);
+    if (it != typeIds.constEnd())
+    {
+        return it.value();
+    }
+
+    int id = types.size();
+    types.append(type);
+    typeIds.insert(type, id);
+    return id;
+}
+
+bool DebugLogModel::matches(const Record &r) const
+{
+    switch (filterColumn)
+    {
+        case COLUMN_TIMESTAMP:
+            return r.timeStamp.contains(filterRegExp);
+        case COLUMN_TYPE:
+            return types.at(r.type).contains(filterRegExp);
+        default:
+            return r.content.contains(filterRegExp);
+    }
+}
+
+void DebugLogModel::dropOldest(int n)
+{
+    n = qMin(n, count);
+    if (n <= 0)
+    {
+        return;
+    }
+
+    qint64 lastDropped = firstSeq + n - 1;
+    int removedRows = n;
+    if (filterActive)
+    {
+        removedRows = 0;
+        while (removedRows < visible.size() && visible.at(removedRows) <= lastDropped)
+        {
+            removedRows++;
+        }
+    }
+
+    if (removedRows)
+    {
+        beginRemoveRows(QModelIndex(), 0, removedRows - 1);
+    }
+
+    for (qint64 seq = firstSeq; seq <= lastDropped; seq++)
+    {
+        recordAt(seq) = Record();
+    }
+    firstSeq += n;
+    count -= n;
+    if (filterActive)
+    {
+        visible.erase(visible.begin(), visible.begin() + removedRows);
+    }
+
+    if (removedRows)
+    {
+        endRemoveRows();
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef DEBUGLOGMODEL_H
+#define DEBUGLOGMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QList>
+#include <QHash>
+#include <QStringList>
+#include <QRegExp>
+
+struct DebugRow
+{
+    DebugRow() : time(0) {}
+
+    qint64 time; // ms since epoch, 0 if unknown
+    QString timeStamp;
+    QString messageType;
+    QString content;
+
+};
+
+/*
+ * Table of log messages stored in a fixed-capacity ring buffer.
+ *
+ * When the buffer is full the oldest messages are dropped, without moving the rest.
+ * Message types are interned, so each record only stores a small id.
+ * The filter is applied once to the whole buffer when it changes; after that only
+ * the new messages are checked.
+ */
+class DebugLogModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum {
+        COLUMN_TIMESTAMP = 0,
+        COLUMN_TYPE,
+        COLUMN_CONTENT,
+        NUM_COLUMNS
+    };
+
+    explicit DebugLogModel(int capacity, QObject *parent = 0);
+
+    static QString columnName(int column);
+    static QString columnValue(const DebugRow &row, int column);
+
+    int capacity() const;
+    void setCapacity(int capacity);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    void appendRows(const QList<DebugRow> &rows);
+    void clear();
+
+    // All the stored messages, ignoring the filter (oldest first)
+    int numRecords() const;
+    DebugRow record(int i) const;
+
+    // An empty pattern disables the filter
+    void setFilter(const QRegExp &regExp, int column);
+    // Row of the first message at or after time (ms since epoch), -1 if there isn't any
+    int rowForTime(qint64 time) const;
+
+private:
+    struct Record
+    {
+        Record() : time(0), type(0) {}
+
+        qint64 time;
+        QString timeStamp;
+        int type;
+        QString content;
+    };
+
+    Record &recordAt(qint64 seq);
+    const Record &recordAt(qint64 seq) const;
+    qint64 seqAtRow(int row) const;
+    int internType(const QString &type);
+    bool matches(const Record &r) const;
+    void dropOldest(int n);
+
+    QVector<Record> records;
+    qint64 firstSeq;
+    int count;
+
+    QStringList types;
+    QHash<QString, int> typeIds;
+
+    bool filterActive;
+    QRegExp filterRegExp;
+    int filterColumn;
+    QList<qint64> visible; // sequence numbers of the messages that match the filter
+};
+
+#endif // DEBUGLOGMODEL_H
@@ -13,10 +13,14 @@ TEMPLATE = app
 
 
 SOURCES += main.cpp \
-    MegaDebugServer.cpp
+    MegaDebugServer.cpp \
+    DebugLogModel.cpp \
+    DebugArchive.cpp
 
 HEADERS  += \
-    MegaDebugServer.h
+    MegaDebugServer.h \
+    DebugLogModel.h \
+    DebugArchive.h
 
 FORMS    += \
     MegaDebugServer.ui
@@ -1,10 +1,22 @@
 #include "MegaDebugServer.h"
 #include "ui_MegaDebugServer.h"
 #include <iostream>
+#include <QtEndian>
+#include <QDateTime>
+#include <QInputDialog>
 
 #define MEGA_LOGGER "MEGA_LOGGER"
 #define ENABLE_MEGASYNC_LOGS "MEGA_ENABLE_LOGS"
-#define MAX_LOG_MESSAGES 16384
+#define DEFAULT_MAX_LOG_MESSAGES 262144
+#define APPEND_INTERVAL_MS 100
+
+// Binary stream: MAGIC + start time (qint64, ms since epoch) followed by records:
+// size of the rest of the record (quint32), log level (quint8),
+// microseconds since the start time (quint64), UTF-8 message
+// All numbers are little endian.
+#define BINARY_STREAM_MAGIC "MLB1"
+#define BINARY_STREAM_HEADER_SIZE 12
+#define BINARY_RECORD_HEADER_SIZE 13
 
 using namespace std;
 
@@ -19,8 +31,11 @@ MegaDebugServer::MegaDebugServer(QWidget *parent) :
     megaSyncClient = NULL;
     megaServer = NULL;
     debugDataModel = NULL;
-    debugProxyModel = NULL;
+    archiveModel = NULL;
     reader = NULL;
+    streamFormat = STREAM_FORMAT_UNKNOWN;
+    streamStartTime = 0;
+    lastXmlTime = 0;
 
     ui->filterTypeComboBox->addItem("Regular Expression", QRegExp::RegExp);
     ui->filterTypeComboBox->addItem("Wildcard", QRegExp::Wildcard);
@@ -40,20 +55,19 @@ MegaDebugServer::MegaDebugServer(QWidget *parent) :
     connect(ui->actionLoad, SIGNAL(triggered()), this, SLOT(loadFromFile()));
     connect(ui->actionClear, SIGNAL(triggered()), this, SLOT(clearDebugWindow()));
     connect(ui->actionStop, SIGNAL(triggered()), this, SLOT(startstop()));
+    connect(ui->actionGoToTime, SIGNAL(triggered()), this, SLOT(goToTime()));
 
-    debugDataModel = new QStandardItemModel(0, 3, this);
-    debugDataModel->setHeaderData(0, Qt::Horizontal,QString::fromUtf8("Timestamp"), Qt::DisplayRole);
-    debugDataModel->setHeaderData(1, Qt::Horizontal,QString::fromUtf8("Message Type"), Qt::DisplayRole);
-    debugDataModel->setHeaderData(2, Qt::Horizontal,QString::fromUtf8("Message"), Qt::DisplayRole);
+    appendTimer.setSingleShot(true);
+    appendTimer.setInterval(APPEND_INTERVAL_MS);
+    connect(&appendTimer, SIGNAL(timeout()), this, SLOT(commitPendingRows()));
 
-    debugProxyModel = new QSortFilterProxyModel;
-    debugProxyModel->setSourceModel(debugDataModel);
-    ui->messagesTreeView->setModel(debugProxyModel);
+    debugDataModel = new DebugLogModel(DEFAULT_MAX_LOG_MESSAGES, this);
+    ui->messagesTreeView->setModel(debugDataModel);
 
-    ui->messagesTreeView->sortByColumn(1, Qt::AscendingOrder);
     ui->messagesTreeView->resizeColumnToContents(0);
     ui->messagesTreeView->resizeColumnToContents(1);
     ui->messagesTreeView->resizeColumnToContents(2);
+    updateGoToTime();
 
     setWindowTitle(tr("MEGAsync Debug Window"));
     startstop();
@@ -63,7 +77,8 @@ void MegaDebugServer::clientConnected()
 {
     timer.stop();
 
-    ui->actionSave->setEnabled(false);
+    // saving while connected starts a capture
+    ui->actionSave->setEnabled(true);
     ui->actionLoad->setEnabled(false);
     ui->statusBar->showMessage(tr("Connected"));
 
@@ -78,7 +93,13 @@ void MegaDebugServer::clientConnected()
         megaSyncClient->disconnectFromServer();
         megaSyncClient->deleteLater();
     }
-    reader = new QXmlStreamReader(megaSyncClient);
+
+    // announce the binary format, MEGAsync keeps sending XML if it doesn't support it
+    streamFormat = STREAM_FORMAT_UNKNOWN;
+    streamBuffer.clear();
+    lastXmlTime = 0;
+    megaSyncClient->write(BINARY_STREAM_MAGIC);
+    megaSyncClient->flush();
 
     connect(megaSyncClient, SIGNAL(readyRead()), this, SLOT(readDebugMsg()));
     connect(megaSyncClient, SIGNAL(disconnected()), this, SLOT(disconnected()));
@@ -97,39 +118,192 @@ void MegaDebugServer::parseReader(QXmlStreamReader *reader)
             dr.timeStamp = attr.value(QString::fromUtf8("timestamp")).toString();
             dr.messageType = attr.value(QString::fromUtf8("type")).toString();
             dr.content = attr.value(QString::fromUtf8("content")).toString();
+
+            // messages without a valid timestamp keep the time of the previous one,
+            // so the times stay sorted for "Go to time"
+            qint64 time = parseXmlTimestamp(dr.timeStamp);
+            if (time)
+            {
+                lastXmlTime = time;
+            }
+            dr.time = lastXmlTime;
             appendDebugRow(&dr);
         }
     } while (!reader->error());
 }
 
+// XML timestamps don't include the year (dd/MM-hh:mm:ss), the most recent one is assumed
+qint64 MegaDebugServer::parseXmlTimestamp(const QString &timeStamp)
+{
+    QString text = timeStamp.trimmed();
+    QDateTime time = QDateTime::fromString(text, QString::fromUtf8("dd/MM-hh:mm:ss.zzz"));
+    if (!time.isValid())
+    {
+        time = QDateTime::fromString(text, QString::fromUtf8("dd/MM-hh:mm:ss"));
+        if (!time.isValid())
+        {
+            return 0;
+        }
+    }
+
+    QDateTime now = QDateTime::currentDateTime();
+    QDate date(now.date().year(), time.date().month(), time.date().day());
+    if (!date.isValid() || QDateTime(date, time.time()) > now.addDays(1))
+    {
+        date = QDate(now.date().year() - 1, time.date().month(), time.date().day());
+    }
+    return date.isValid() ? QDateTime(date, time.time()).toMSecsSinceEpoch() : 0;
+}
+
 void MegaDebugServer::readDebugMsg()
 {
-    parseReader(reader);
+    if (!megaSyncClient)
+    {
+        return;
+    }
+
+    if (streamFormat == STREAM_FORMAT_XML)
+    {
+        reader->addData(megaSyncClient->readAll());
+        parseReader(reader);
+        return;
+    }
+
+    streamBuffer.append(megaSyncClient->readAll());
+    if (streamFormat == STREAM_FORMAT_UNKNOWN)
+    {
+        int magicSize = strlen(BINARY_STREAM_MAGIC);
+        if (streamBuffer.size() < magicSize)
+        {
+            return;
+        }
+
+        if (!streamBuffer.startsWith(BINARY_STREAM_MAGIC))
+        {
+            streamFormat = STREAM_FORMAT_XML;
+            reader = new QXmlStreamReader();
+            reader->addData(streamBuffer);
+            streamBuffer.clear();
+            parseReader(reader);
+            return;
+        }
+
+        if (streamBuffer.size() < BINARY_STREAM_HEADER_SIZE)
+        {
+            return;
+        }
+
+        streamStartTime = qFromLittleEndian<qint64>((const uchar *)streamBuffer.constData() + magicSize);
+        streamBuffer.remove(0, BINARY_STREAM_HEADER_SIZE);
+        streamFormat = STREAM_FORMAT_BINARY;
+    }
+
+    parseBinaryRecords();
+}
+
+void MegaDebugServer::parseBinaryRecords()
+{
+    static const char *levels[] = { "fatal", "error", "warning", "info", "debug", "verbose" };
+
+    int pos = 0;
+    while (pos + BINARY_RECORD_HEADER_SIZE <= streamBuffer.size())
+    {
+        const uchar *header = (const uchar *)streamBuffer.constData() + pos;
+        int size = qFromLittleEndian<quint32>(header);
+        if (size < BINARY_RECORD_HEADER_SIZE - 4)
+        {
+            // corrupt stream
+            streamBuffer.clear();
+            return;
+        }
+
+        if (pos + 4 + size > streamBuffer.size())
+        {
+            break;
+        }
+
+        int level = header[4];
+        qint64 timestamp = streamStartTime + qFromLittleEndian<quint64>(header + 5) / 1000;
+
+        DebugRow dr;
+        dr.time = timestamp;
+        dr.timeStamp = QDateTime::fromMSecsSinceEpoch(timestamp).toString(QString::fromUtf8("dd/MM-hh:mm:ss.zzz"));
+        dr.messageType = QString::fromUtf8((level >= 0 && level < 6) ? levels[level] : "unknown");
+        dr.content = QString::fromUtf8(streamBuffer.constData() + pos + BINARY_RECORD_HEADER_SIZE,
+                                       size - (BINARY_RECORD_HEADER_SIZE - 4));
+        appendDebugRow(&dr);
+        pos += 4 + size;
+    }
+    streamBuffer.remove(0, pos);
 }
 
 void MegaDebugServer::appendDebugRow(DebugRow *dr)
 {
-    int index = debugDataModel->rowCount();
+    pendingRows.append(*dr);
+    if (!appendTimer.isActive())
+    {
+        appendTimer.start();
+    }
+}
 
-    if (index >= MAX_LOG_MESSAGES)
+void MegaDebugServer::commitPendingRows()
+{
+    appendTimer.stop();
+    if (pendingRows.isEmpty())
+    {
+        return;
+    }
+
+    if (captureWriter.isOpen())
     {
-        QList<QStandardItem*> items = debugDataModel->takeRow(0);
-        for (int i = 0; i < items.size(); i++)
+        for (int i = 0; i < pendingRows.size(); i++)
         {
-            delete items[i];
+            captureWriter.addRow(pendingRows.at(i));
         }
-        index--;
     }
 
-    QStandardItem *ts = new QStandardItem(dr->timeStamp);
-    QStandardItem *mt = new QStandardItem(dr->messageType);
-    QStandardItem *c = new QStandardItem(dr->content);
+    debugDataModel->appendRows(pendingRows);
+    pendingRows.clear();
+    if (!archiveModel)
+    {
+        ui->messagesTreeView->scrollToBottom();
+        updateGoToTime();
+    }
+}
 
-    debugDataModel->setItem(index, 0, ts);
-    debugDataModel->setItem(index, 1, mt);
-    debugDataModel->setItem(index, 2, c);
+void MegaDebugServer::setLogCapacity(int capacity)
+{
+    commitPendingRows();
+    debugDataModel->setCapacity(capacity);
+}
+
+void MegaDebugServer::runIngestBenchmark(int numMessages)
+{
+    static const char *types[] = { "debug", "info", "warning", "verbose" };
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    qint64 startTime = QDateTime::currentMSecsSinceEpoch();
+    for (int i = 0; i < numMessages; i++)
+    {
+        DebugRow dr;
+        dr.time = startTime + i;
+        dr.timeStamp = QString::number(i);
+        dr.messageType = QString::fromUtf8(types[i % 4]);
+        dr.content = QString::fromUtf8("Synthetic log message number %1 for the ingest benchmark").arg(i);
+        appendDebugRow(&dr);
+        if (pendingRows.size() >= 4096)
+        {
+            commitPendingRows();
+        }
+    }
+    commitPendingRows();
 
-    ui->messagesTreeView->scrollToBottom();
+    qint64 ms = qMax(elapsed.elapsed(), qint64(1));
+    QString result = QString::fromUtf8("Ingested %1 messages in %2 ms (%3 lines/sec)")
+            .arg(numMessages).arg(ms).arg(numMessages * 1000LL / ms);
+    ui->statusBar->showMessage(result);
+    cout << result.toUtf8().constData() << endl;
 }
 
 void MegaDebugServer::startstop()
@@ -147,6 +321,7 @@ void MegaDebugServer::startstop()
         }
 
         connect(megaServer,SIGNAL(newConnection()),this,SLOT(clientConnected()));
+        showLiveLog();
         ui->actionSave->setEnabled(false);
         ui->actionLoad->setEnabled(false);
         ui->statusBar->showMessage("Ready");
@@ -167,9 +342,13 @@ void MegaDebugServer::disconnected()
 {
     if (megaServer)
     {
+        commitPendingRows();
+        stopCapture();
         delete reader;
         megaServer->deleteLater();
         reader = NULL;
+        streamFormat = STREAM_FORMAT_UNKNOWN;
+        streamBuffer.clear();
         megaServer = NULL;
         megaSyncClient = NULL;
         ui->actionSave->setEnabled(true);
@@ -187,82 +366,128 @@ void MegaDebugServer::tryConnect()
 
 void MegaDebugServer::filterTextRegExp()
 {
-    qDebug() << ui->filterTypeComboBox->itemData(ui->filterTypeComboBox->currentIndex()).toInt();
     QRegExp::PatternSyntax syntax = QRegExp::PatternSyntax(ui->filterTypeComboBox->itemData(ui->filterTypeComboBox->currentIndex()).toInt());
     Qt::CaseSensitivity caseSensitivity = ui->caseSensitivecheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive;
     QRegExp regExp(ui->filterPatternLineEdit->text(), caseSensitivity, syntax);
-    qDebug() << regExp;
-    debugProxyModel->setFilterRegExp(regExp);
+    commitPendingRows();
+    if (archiveModel)
+    {
+        archiveModel->setFilter(regExp, ui->columnComboBox->currentIndex());
+    }
+    else
+    {
+        debugDataModel->setFilter(regExp, ui->columnComboBox->currentIndex());
+    }
 }
 
 void MegaDebugServer::filterColumn()
 {
-    debugProxyModel->setFilterKeyColumn(ui->columnComboBox->currentIndex());
+    filterTextRegExp();
 }
 
 void MegaDebugServer::filterCaseSensitive()
 {
-    debugProxyModel->setSortCaseSensitivity(ui->caseSensitivecheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive);
+    filterTextRegExp();
 }
 
 void MegaDebugServer::saveToFile()
 {
+    if (captureWriter.isOpen())
+    {
+        commitPendingRows();
+        stopCapture();
+        return;
+    }
+
     QString fileName = QFileDialog::getSaveFileName(this,
              tr("Save Debug Log"), "",
-             tr("Log File (*.dat);;All Files (*)"));
+             tr("Log Archive (*.mla);;All Files (*)"));
 
     if (fileName.isEmpty())
     {
         return;
     }
 
-    QFile file(fileName);
-    if (!file.open(QIODevice::WriteOnly | QFile::Truncate))
+    commitPendingRows();
+    if (archiveModel)
     {
-        QMessageBox::information(this, tr("Unable to open file"), file.errorString());
+        // the loaded archive is already in this format
+        QFile::remove(fileName);
+        if (!QFile::copy(archiveModel->archiveReader()->fileName(), fileName))
+        {
+            QMessageBox::information(this, tr("Unable to save file"), fileName);
+        }
         return;
     }
 
-    QByteArray ba;
-    QXmlStreamWriter xmlWriterLog(&ba);
-    QDataStream out(&file);
-    out.setVersion(QDataStream::Qt_4_8);
-    qint32 n(debugDataModel->rowCount());
-
-    /* Writes a document start with the XML version number. */
-    xmlWriterLog.writeStartDocument();
-    xmlWriterLog.writeStartElement("MEGA");
+    if (!captureWriter.open(fileName))
+    {
+        QMessageBox::information(this, tr("Unable to open file"), fileName);
+        return;
+    }
+
+    int n = debugDataModel->numRecords();
     for (int i = 0; i < n; i++)
     {
-        xmlWriterLog.writeStartElement("log");
-        //Add timestamp and value
-        xmlWriterLog.writeAttribute("timestamp", debugDataModel->item(i,0)->text());
-        //Add type and value
-        xmlWriterLog.writeAttribute("type", debugDataModel->item(i,1)->text());
-        //Add content and value
-        xmlWriterLog.writeAttribute("content", debugDataModel->item(i,2)->text());
-        xmlWriterLog.writeEndElement();
+        captureWriter.addRow(debugDataModel->record(i));
     }
 
-    //Close tags
-    xmlWriterLog.writeEndElement();
-    xmlWriterLog.writeEndDocument();
-    out << qCompress(ba);
-    file.close();
+    if (megaSyncClient)
+    {
+        // keep writing the new messages until Save is pressed again
+        ui->actionSave->setText(tr("Stop saving"));
+        ui->statusBar->showMessage(tr("Saving to %1").arg(fileName));
+        return;
+    }
+
+    stopCapture();
 }
 
+void MegaDebugServer::stopCapture()
+{
+    if (!captureWriter.isOpen())
+    {
+        return;
+    }
+
+    if (!captureWriter.close())
+    {
+        QMessageBox::information(this, tr("Unable to save file"), tr("Error writing the log archive"));
+    }
+    ui->actionSave->setText(tr("Save"));
+}
 
 void MegaDebugServer::loadFromFile()
 {
     QString fileName = QFileDialog::getOpenFileName(this,
              tr("Open Log File"), "",
-             tr("Log File (*.dat);;All Files (*)"));
+             tr("Log File (*.mla *.dat);;All Files (*)"));
 
     if (fileName.isEmpty())
     {
         return;
     }
 
+    if (DebugArchiveReader::isArchive(fileName))
+    {
+        DebugArchiveReader *archiveReader = new DebugArchiveReader();
+        if (!archiveReader->open(fileName))
+        {
+            delete archiveReader;
+            QMessageBox::information(this, tr("Unable to open file"), tr("Invalid log archive"));
+            return;
+        }
+
+        clearDebugWindow();
+        archiveModel = new DebugArchiveModel(archiveReader, this);
+        ui->messagesTreeView->setModel(archiveModel);
+        filterTextRegExp();
+        updateGoToTime();
+        ui->statusBar->showMessage(tr("%1 messages").arg(archiveReader->numRecords()));
+        return;
+    }
+
+    // logs saved by previous versions: compressed XML
     QFile file(fileName);
     if (!file.open(QIODevice::ReadOnly))
     {
@@ -277,18 +502,89 @@ void MegaDebugServer::loadFromFile()
     in >> ba;
 
     QXmlStreamReader xmlLoad(qUncompress(ba));
+    lastXmlTime = 0;
     parseReader(&xmlLoad);
+    commitPendingRows();
     file.close();
 }
 
 void MegaDebugServer::clearDebugWindow()
 {
-    debugDataModel->removeRows(0,debugDataModel->rowCount());
+    pendingRows.clear();
+    appendTimer.stop();
+    showLiveLog();
+    debugDataModel->clear();
+    updateGoToTime();
+}
+
+void MegaDebugServer::showLiveLog()
+{
+    if (!archiveModel)
+    {
+        return;
+    }
+
+    ui->messagesTreeView->setModel(debugDataModel);
+    archiveModel->deleteLater();
+    archiveModel = NULL;
+    filterTextRegExp();
+    updateGoToTime();
 }
+
+// times are sorted, so the messages have times if the last one has it
+void MegaDebugServer::updateGoToTime()
+{
+    bool hasTimes;
+    if (archiveModel)
+    {
+        DebugArchiveReader *archiveReader = archiveModel->archiveReader();
+        int numBlocks = archiveReader->numBlocks();
+        hasTimes = numBlocks && archiveReader->blockInfo(numBlocks - 1).lastTime > 0;
+    }
+    else
+    {
+        int numRecords = debugDataModel->numRecords();
+        hasTimes = numRecords && debugDataModel->record(numRecords - 1).time > 0;
+    }
+    ui->actionGoToTime->setEnabled(hasTimes);
+}
+
+void MegaDebugServer::goToTime()
+{
+    bool ok = false;
+    QString format = QString::fromUtf8("yyyy-MM-dd hh:mm:ss");
+    QString text = QInputDialog::getText(this, tr("Go to time"), tr("Time (%1):").arg(format),
+                                         QLineEdit::Normal, QDateTime::currentDateTime().toString(format), &ok);
+    if (!ok)
+    {
+        return;
+    }
+
+    QDateTime time = QDateTime::fromString(text.trimmed(), format);
+    if (!time.isValid())
+    {
+        ui->statusBar->showMessage(tr("Invalid time"));
+        return;
+    }
+
+    commitPendingRows();
+    qint64 ms = time.toMSecsSinceEpoch();
+    int row = archiveModel ? archiveModel->rowForTime(ms) : debugDataModel->rowForTime(ms);
+    if (row < 0)
+    {
+        ui->statusBar->showMessage(tr("No messages after %1").arg(text));
+        return;
+    }
+
+    QAbstractItemModel *model = ui->messagesTreeView->model();
+    QModelIndex index = model->index(row, 0);
+    ui->messagesTreeView->scrollTo(index, QAbstractItemView::PositionAtTop);
+    ui->messagesTreeView->setCurrentIndex(index);
+}
+
 MegaDebugServer::~MegaDebugServer()
 {
     disconnected();
-    delete debugDataModel;
-    delete debugProxyModel;
+    stopCapture();
     delete ui;
 }
@@ -5,20 +5,14 @@
 #include <QLocalServer>
 #include <QLocalSocket>
 #include <QObject>
-#include <QSortFilterProxyModel>
-#include <QStandardItemModel>
 #include <QXmlStreamReader>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QTimer>
+#include <QElapsedTimer>
 
-struct DebugRow
-{
-    QString timeStamp;
-    QString messageType;
-    QString content;
-
-};
+#include "DebugLogModel.h"
+#include "DebugArchive.h"
 
 namespace Ui {
 class MegaDebugServer;
@@ -33,6 +27,10 @@ public:
 
     ~MegaDebugServer();
 
+    void setLogCapacity(int capacity);
+    // appends synthetic messages and prints the ingest rate
+    void runIngestBenchmark(int numMessages);
+
 private:
     Ui::MegaDebugServer *ui;
     QLocalServer *megaServer;
@@ -40,10 +38,35 @@ private:
     QXmlStreamReader *reader;
     QLocalSocket client;
 
-    QSortFilterProxyModel *debugProxyModel;
-    QStandardItemModel *debugDataModel;
+    DebugLogModel *debugDataModel;
+    // archive being shown instead of the live messages, NULL if there isn't any
+    DebugArchiveModel *archiveModel;
+    // messages are written to the archive as they arrive while it's open
+    DebugArchiveWriter captureWriter;
     QTimer timer;
 
+    // new messages are added to the model in batches
+    QList<DebugRow> pendingRows;
+    QTimer appendTimer;
+
+    // MEGAsync sends XML to viewers that don't announce the binary format
+    enum {
+        STREAM_FORMAT_UNKNOWN = 0,
+        STREAM_FORMAT_XML,
+        STREAM_FORMAT_BINARY
+    };
+    int streamFormat;
+    QByteArray streamBuffer;
+    qint64 streamStartTime;
+    // time of the last XML message with a valid timestamp
+    qint64 lastXmlTime;
+
+    void parseBinaryRecords();
+    static qint64 parseXmlTimestamp(const QString &timeStamp);
+    void showLiveLog();
+    void stopCapture();
+    void updateGoToTime();
+
 private slots:
     void clientConnected();
     void readDebugMsg();
@@ -56,10 +79,12 @@ private slots:
     void filterCaseSensitive();
 
     void appendDebugRow(DebugRow *);
+    void commitPendingRows();
 
     void saveToFile();
     void loadFromFile();
     void clearDebugWindow();
+    void goToTime();
 
 public:
     void parseReader(QXmlStreamReader *);
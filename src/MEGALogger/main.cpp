@@ -1,4 +1,5 @@
 #include <QApplication>
+#include <QStringList>
 #include "MegaDebugServer.h"
 
 int main(int argc, char *argv[])
@@ -7,5 +8,27 @@ int main(int argc, char *argv[])
     MegaDebugServer w;
     w.show();
 
+    // --capacity <messages> keeps more (or less) messages in the window
+    // --benchmark <messages> measures how fast messages are added
+    QStringList args = a.arguments();
+    for (int i = 1; i + 1 < args.size(); i += 2)
+    {
+        bool ok;
+        int value = args.at(i + 1).toInt(&ok);
+        if (!ok || value <= 0)
+        {
+            continue;
+        }
+
+        if (args.at(i) == QString::fromUtf8("--capacity"))
+        {
+            w.setLogCapacity(value);
+        }
+        else if (args.at(i) == QString::fromUtf8("--benchmark"))
+        {
+            w.runIngestBenchmark(value);
+        }
+    }
+
     return a.exec();
 }
@@ -224,7 +224,8 @@ QString MEGASyncPlugin::sendRequest(char type, QString command)
             return QString();
     }
 
-    req.sprintf("%c:%s", type, command.toStdString().c_str());
+    // every request is terminated by a newline
+    req.sprintf("%c:%s\n", type, command.toStdString().c_str());
 
     sock.write(req.toUtf8());
     sock.flush();
@@ -7,6 +7,11 @@
 #include "mega_notify_client.h"
 #include <string.h>
 
+// the cache is dropped when it grows over this number of entries
+#define MAX_CACHED_STATES 262144
+// number of folders the notify server sends state changes for
+#define MAX_SUBSCRIBED_DIRS 16
+
 static GObjectClass *parent_class;
 
 static void mega_ext_class_init(MEGAExtClass *class)
@@ -21,6 +26,9 @@ static void mega_ext_instance_init(MEGAExt *mega_ext)
     mega_ext->chan = NULL;
     mega_ext->num_retries = 2;
     mega_ext->h_syncs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    mega_ext->h_states = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    mega_ext->h_dirs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    mega_ext->subscribed_dirs = g_queue_new();
     mega_ext->string_getlink = NULL;
     mega_ext->string_upload = NULL;
     mega_ext->syncs_received = FALSE;
@@ -47,8 +55,21 @@ static const gchar *file_state_to_str(FileState state)
     }
 }
 
-// received path from notify server with the path to item which state was changed
-void mega_ext_on_item_changed(MEGAExt *mega_ext, const gchar *path)
+// forget all the cached states
+static void mega_ext_cache_clear(MEGAExt *mega_ext)
+{
+    g_hash_table_remove_all(mega_ext->h_states);
+    g_hash_table_remove_all(mega_ext->h_dirs);
+}
+
+// cached states are only valid while the notify server reports the changes
+static gboolean mega_ext_cache_enabled(MEGAExt *mega_ext)
+{
+    return mega_ext->notify_chan && mega_ext->syncs_received;
+}
+
+// ask Nautilus to refresh the information of an item
+static void mega_ext_update_item(MEGAExt *mega_ext, const gchar *path)
 {
     GFile *f;
     f = g_file_new_for_path(path);
@@ -66,6 +87,52 @@ void mega_ext_on_item_changed(MEGAExt *mega_ext, const gchar *path)
     nautilus_info_provider_update_file_info((NautilusInfoProvider*)mega_ext, file, (void*)1, (void*)1);
 }
 
+// received path from notify server with the path to item which state was changed
+void mega_ext_on_item_changed(MEGAExt *mega_ext, const gchar *path)
+{
+    // a sync being enabled or disabled changes the state of everything inside it
+    if (g_hash_table_contains(mega_ext->h_syncs, path))
+        mega_ext_cache_clear(mega_ext);
+    else
+        g_hash_table_remove(mega_ext->h_states, path);
+
+    mega_ext_update_item(mega_ext, path);
+}
+
+// received the new state of an item inside one of the subscribed folders
+void mega_ext_on_item_state_changed(MEGAExt *mega_ext, const gchar *path, FileState state)
+{
+    if (g_hash_table_contains(mega_ext->h_syncs, path))
+        mega_ext_cache_clear(mega_ext);
+    g_hash_table_insert(mega_ext->h_states, g_strdup(path), GINT_TO_POINTER(state));
+
+    mega_ext_update_item(mega_ext, path);
+}
+
+// the notify server forgot our subscriptions and we missed the changes
+void mega_ext_on_notify_disconnected(MEGAExt *mega_ext)
+{
+    mega_ext_cache_clear(mega_ext);
+    g_queue_free_full(mega_ext->subscribed_dirs, g_free);
+    mega_ext->subscribed_dirs = g_queue_new();
+}
+
+// receive the state changes of the items of a folder with the notifications
+static void mega_ext_subscribe_dir(MEGAExt *mega_ext, const gchar *dir)
+{
+    gchar *oldest;
+
+    if (!mega_notify_client_subscribe(mega_ext, dir, TRUE))
+        return;
+    g_queue_push_tail(mega_ext->subscribed_dirs, g_strdup(dir));
+
+    if (g_queue_get_length(mega_ext->subscribed_dirs) > MAX_SUBSCRIBED_DIRS) {
+        oldest = g_queue_pop_head(mega_ext->subscribed_dirs);
+        mega_notify_client_subscribe(mega_ext, oldest, FALSE);
+        g_free(oldest);
+    }
+}
+
 // user clicked on "Upload to MEGA" menu item
 static void mega_ext_on_upload_selected(NautilusMenuItem *item, gpointer user_data)
 {
@@ -108,12 +175,14 @@ void mega_ext_on_sync_add(MEGAExt *mega_ext, const gchar *path)
     if (!strcmp(path, "."))
         return;
     g_debug("New sync path: %s", path);
+    mega_ext_cache_clear(mega_ext);
     g_hash_table_insert(mega_ext->h_syncs, g_strdup(path), GINT_TO_POINTER(1));
 }
 
 void mega_ext_on_sync_del(MEGAExt *mega_ext, const gchar *path)
 {
     g_debug("Deleted sync path: %s", path);
+    mega_ext_cache_clear(mega_ext);
     g_hash_table_remove(mega_ext->h_syncs, path);
 }
 
@@ -141,6 +210,76 @@ static gboolean mega_ext_path_in_sync(MEGAExt *mega_ext, const gchar *path)
     return found;
 }
 
+// request the state of all the entries of a folder in a single batch
+static void mega_ext_prefetch_dir_states(MEGAExt *mega_ext, const gchar *dir_path)
+{
+    GDir *dir;
+    const gchar *name;
+    GPtrArray *paths;
+    FileState *states;
+    guint i;
+
+    dir = g_dir_open(dir_path, 0, NULL);
+    if (!dir)
+        return;
+
+    paths = g_ptr_array_new_with_free_func(g_free);
+    while ((name = g_dir_read_name(dir))) {
+        // newlines are used as request terminators
+        if (strchr(name, '\n'))
+            continue;
+        g_ptr_array_add(paths, g_build_filename(dir_path, name, NULL));
+    }
+    g_dir_close(dir);
+
+    states = g_new(FileState, paths->len);
+    if (paths->len && mega_ext_client_get_path_states(mega_ext, (const gchar **)paths->pdata, paths->len, states)) {
+        for (i = 0; i < paths->len; i++)
+            g_hash_table_insert(mega_ext->h_states, g_strdup(g_ptr_array_index(paths, i)), GINT_TO_POINTER(states[i]));
+    }
+    g_debug("Prefetched %u states for %s", paths->len, dir_path);
+
+    g_free(states);
+    g_ptr_array_free(paths, TRUE);
+}
+
+// get the state of a path, fetching the states of the whole folder the first time
+// one of its entries is requested. The states are cached until the notify server
+// reports a change, so listing the same folder again doesn't need any request
+static FileState mega_ext_get_path_state(MEGAExt *mega_ext, const gchar *path)
+{
+    gpointer value;
+    gchar *dir;
+    FileState state;
+
+    if (!mega_ext_cache_enabled(mega_ext))
+        return mega_ext_client_get_path_state(mega_ext, path);
+
+    if (g_hash_table_lookup_extended(mega_ext->h_states, path, NULL, &value))
+        return GPOINTER_TO_INT(value);
+
+    dir = g_path_get_dirname(path);
+    if (!g_hash_table_contains(mega_ext->h_dirs, dir)) {
+        if (g_hash_table_size(mega_ext->h_states) > MAX_CACHED_STATES)
+            mega_ext_cache_clear(mega_ext);
+
+        mega_ext_prefetch_dir_states(mega_ext, dir);
+        mega_ext_subscribe_dir(mega_ext, dir);
+        g_hash_table_add(mega_ext->h_dirs, dir);
+
+        if (g_hash_table_lookup_extended(mega_ext->h_states, path, NULL, &value))
+            return GPOINTER_TO_INT(value);
+    } else {
+        g_free(dir);
+    }
+
+    state = mega_ext_client_get_path_state(mega_ext, path);
+    if (state != FILE_ERROR)
+        g_hash_table_insert(mega_ext->h_states, g_strdup(path), GINT_TO_POINTER(state));
+
+    return state;
+}
+
 // user clicked on "Get MEGA link" menu item
 static void mega_ext_on_get_link_selected(NautilusMenuItem *item, gpointer user_data)
 {
@@ -320,7 +459,7 @@ static NautilusOperationResult mega_ext_update_file_info(NautilusInfoProvider *p
     }
     g_debug("mega_ext_update_file_info %s", path);
 
-    state = mega_ext_client_get_path_state(mega_ext, path);
+    state = mega_ext_get_path_state(mega_ext, path);
     g_debug("mega_ext_update_file_info. File: %s  State: %s", path, file_state_to_str(state));
     g_free(path);
 
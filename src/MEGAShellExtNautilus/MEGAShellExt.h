@@ -22,6 +22,9 @@ struct _MEGAExt {
     gboolean syncs_received; // TRUE if the list with sync folders is received
 
     GHashTable *h_syncs; // table of paths of shared folders
+    GHashTable *h_states; // cached path states, kept up to date by the notify server
+    GHashTable *h_dirs; // folders whose entries were requested in a single batch
+    GQueue *subscribed_dirs; // folders the notify server sends state changes for
     gchar *string_upload; // cached string
     gchar *string_getlink; // cached string
 };
@@ -51,6 +54,8 @@ void  mega_ext_register_type(GTypeModule *module);
 G_END_DECLS
 
 void mega_ext_on_item_changed(MEGAExt *mega_ext, const gchar *path);
+void mega_ext_on_item_state_changed(MEGAExt *mega_ext, const gchar *path, FileState state);
+void mega_ext_on_notify_disconnected(MEGAExt *mega_ext);
 void mega_ext_on_sync_add(MEGAExt *mega_ext, const gchar *path);
 void mega_ext_on_sync_del(MEGAExt *mega_ext, const gchar *path);
 
@@ -12,6 +12,10 @@ const gchar OP_LINK        = 'L'; //paste Link
 const gchar OP_SHARE       = 'S'; //Share folder
 const gchar OP_SEND        = 'C'; //Copy to user
 const gchar OP_STRING      = 'T'; //Get Translated String
+const gchar OP_BATCH_STATE = 'B'; //Path state of several paths
+
+// maximum number of paths sent in a single batch request
+#define MAX_BATCH_PATHS 1024
 
 static void mega_ext_client_disconnect(MEGAExt *mega_ext);
 
@@ -77,19 +81,16 @@ static void mega_ext_client_disconnect(MEGAExt *mega_ext)
     mega_ext->srv_sock = -1;
 }
 
-// send request and receive response from Extension server
+// send a formatted request and receive response from Extension server
 // Return newly-allocated response string
-static gchar *mega_ext_client_send_request(MEGAExt *mega_ext, gchar type, const gchar *in)
+static gchar *mega_ext_client_send_raw_request(MEGAExt *mega_ext, const gchar *request, gsize len)
 {
     gchar *out = NULL;
-    gchar *tmp;
     gsize bytes_written;
     GError *error;
     GIOStatus status;
     gint num_retries;
 
-    g_debug("Sending request: %s ", in);
-
     // try to send request several times
     for (num_retries = 0; num_retries < mega_ext->num_retries; num_retries++) {
         if (mega_ext->srv_sock < 0) {
@@ -99,19 +100,14 @@ static gchar *mega_ext_client_send_request(MEGAExt *mega_ext, gchar type, const
             }
         }
 
-        // format request string
-        tmp = g_strdup_printf("%c:%s", type, in);
-
         error = NULL;
         // try to send request
-        status = g_io_channel_write_chars(mega_ext->chan, tmp, strlen(tmp), &bytes_written, &error);
+        status = g_io_channel_write_chars(mega_ext->chan, request, len, &bytes_written, &error);
         if (status != G_IO_STATUS_NORMAL || error) {
             g_warning("Failed to write data!");
-            g_free(tmp);
             mega_ext_client_disconnect(mega_ext);
             continue;
         }
-        g_free(tmp);
 
         status = g_io_channel_flush(mega_ext->chan, &error);
         if (status != G_IO_STATUS_NORMAL || error) {
@@ -126,6 +122,7 @@ static gchar *mega_ext_client_send_request(MEGAExt *mega_ext, gchar type, const
             g_warning("Failed to read data!");
             if (out)
                 g_free(out);
+            out = NULL;
             mega_ext_client_disconnect(mega_ext);
             continue;
         }
@@ -142,6 +139,23 @@ static gchar *mega_ext_client_send_request(MEGAExt *mega_ext, gchar type, const
     return out;
 }
 
+// send request and receive response from Extension server
+// Return newly-allocated response string
+static gchar *mega_ext_client_send_request(MEGAExt *mega_ext, gchar type, const gchar *in)
+{
+    gchar *out;
+    gchar *tmp;
+
+    g_debug("Sending request: %s ", in);
+
+    // format request string, every request is terminated by a newline
+    tmp = g_strdup_printf("%c:%s\n", type, in);
+    out = mega_ext_client_send_raw_request(mega_ext, tmp, strlen(tmp));
+    g_free(tmp);
+
+    return out;
+}
+
 // return a newly-allocated string
 gchar *mega_ext_client_get_string(MEGAExt *mega_ext, int stringID, int numFiles, int numFolders)
 {
@@ -160,6 +174,10 @@ FileState mega_ext_client_get_path_state(MEGAExt *mega_ext, const gchar *path)
     gchar *out;
     FileState st;
 
+    // newlines are used as request terminators
+    if (strchr(path, '\n'))
+        return FILE_ERROR;
+
     out = mega_ext_client_send_request(mega_ext, OP_PATH_STATE, path);
 
     if (!out)
@@ -171,6 +189,44 @@ FileState mega_ext_client_get_path_state(MEGAExt *mega_ext, const gchar *path)
     return st;
 }
 
+// get the state of several paths using as few requests as possible
+// states must have room for num_paths elements
+// return FALSE if the state of any path couldn't be retrieved
+gboolean mega_ext_client_get_path_states(MEGAExt *mega_ext, const gchar **paths, guint num_paths, FileState *states)
+{
+    guint first, i;
+
+    for (first = 0; first < num_paths; first += MAX_BATCH_PATHS) {
+        guint last = MIN(first + MAX_BATCH_PATHS, num_paths);
+        GString *request = g_string_new(NULL);
+        gchar *out;
+        gsize out_len;
+
+        g_string_append_c(request, OP_BATCH_STATE);
+        g_string_append_c(request, ':');
+        for (i = first; i < last; i++) {
+            if (i > first)
+                g_string_append_c(request, '\0');
+            g_string_append(request, paths[i]);
+        }
+        g_string_append_c(request, '\n');
+
+        g_debug("Sending batch request with %u paths", last - first);
+        out = mega_ext_client_send_raw_request(mega_ext, request->str, request->len);
+        g_string_free(request, TRUE);
+
+        if (!out)
+            return FALSE;
+
+        out_len = strlen(out);
+        for (i = first; i < last; i++)
+            states[i] = (i - first < out_len) ? (FileState)(out[i - first] - '0') : FILE_ERROR;
+        g_free(out);
+    }
+
+    return TRUE;
+}
+
 gboolean mega_ext_client_paste_link(MEGAExt *mega_ext, const gchar *path)
 {
     gchar *out;
@@ -83,6 +83,38 @@ void mega_notify_client_destroy(MEGAExt *mega_ext)
         close(mega_ext->notify_sock);
     mega_ext->notify_sock = -1;
     mega_ext->syncs_received = FALSE;
+    mega_ext_on_notify_disconnected(mega_ext);
+}
+
+// ask the notify server to send (or stop sending) the new state of the items
+// changed inside a folder
+gboolean mega_notify_client_subscribe(MEGAExt *mega_ext, const gchar *dir, gboolean subscribe)
+{
+    gchar *out;
+    gsize len, sent = 0;
+    ssize_t n;
+
+    // newlines are used as command terminators
+    if (mega_ext->notify_sock < 0 || strchr(dir, '\n'))
+        return FALSE;
+
+    // the channel is buffered for reading, write to the socket directly
+    out = g_strdup_printf("%c%s\n", subscribe ? 'S' : 'U', dir);
+    len = strlen(out);
+    while (sent < len) {
+        n = send(mega_ext->notify_sock, out + sent, len - sent, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            g_warning("Failed to send subscription: %s", strerror(errno));
+            g_free(out);
+            return FALSE;
+        }
+        sent += n;
+    }
+    g_free(out);
+
+    return TRUE;
 }
 
 static gboolean mega_notify_client_read(GIOChannel *notify_chan, GIOCondition condition, gpointer data)
@@ -133,6 +165,11 @@ static gboolean mega_notify_client_read(GIOChannel *notify_chan, GIOCondition co
         case 'P': // item state changed
             mega_ext_on_item_changed(mega_ext, p);
             break;
+        case 'N': // new state of an item inside a subscribed folder
+            if (p[0] < '0' || p[0] > '9' || !p[1])
+                break;
+            mega_ext_on_item_state_changed(mega_ext, p + 1, p[0] - '0');
+            break;
         case 'A': // sync folder added
             mega_ext_on_sync_add(mega_ext, p);
             mega_ext->syncs_received = TRUE;
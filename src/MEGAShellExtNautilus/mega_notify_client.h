@@ -5,5 +5,6 @@
 
 void mega_notify_client_timer_start(MEGAExt *mega_ext);
 void mega_notify_client_destroy(MEGAExt *mega_ext);
+gboolean mega_notify_client_subscribe(MEGAExt *mega_ext, const gchar *dir, gboolean subscribe);
 
 #endif
@@ -12,6 +12,7 @@ static void mega_ext_finalize(GObject *object);
 static GList* mega_ext_get_file_actions(ThunarxMenuProvider *provider, GtkWidget *window, GList *files);
 static GList* mega_ext_get_folder_actions(ThunarxMenuProvider *provider, GtkWidget *window, ThunarxFileInfo *folder);
 static gboolean mega_ext_path_in_sync(MEGAExt *mega_ext, const gchar *path);
+static FileState *mega_ext_get_files_states(MEGAExt *mega_ext, GList *files);
 
 static GType type_list[1];
 
@@ -172,42 +173,21 @@ static GList* mega_ext_get_file_actions(ThunarxMenuProvider *provider, G_GNUC_UN
     GList *l, *l_out = NULL;
     int syncedFiles, syncedFolders, unsyncedFiles, unsyncedFolders;
     gchar *out = NULL;
+    FileState *states;
+    guint i;
 
     g_debug("mega_ext_get_file_items: %u", g_list_length(files));
 
     syncedFiles = syncedFolders = unsyncedFiles = unsyncedFolders = 0;
 
+    // the states of all the selected files are requested at once
+    states = mega_ext_get_files_states(mega_ext, files);
+
     // get list of selected objects
-    for (l = files; l != NULL; l = l->next)
+    for (l = files, i = 0; l != NULL; l = l->next, i++)
     {
         ThunarxFileInfo *file = THUNARX_FILE_INFO(l->data);
-        gchar *path;
-        GFile *fp;
-        FileState state;
-
-        fp = thunarx_file_info_get_location(file);
-        if (!fp)
-        {
-            continue;
-        }
-
-        path = g_file_get_path(fp);
-        if (!path)
-        {
-            continue;
-        }
-
-        // avoid sending requests for files which are not in synced folders
-        // but make sure we received the list of synced folders first
-        if (mega_ext->syncs_received && !mega_ext_path_in_sync(mega_ext, path))
-        {
-            state = FILE_NOTFOUND;
-        }
-        else
-        {
-            state = mega_ext_client_get_path_state(mega_ext, path);
-        }
-        g_free(path);
+        FileState state = states[i];
 
         if (state == FILE_ERROR)
         {
@@ -243,6 +223,8 @@ static GList* mega_ext_get_file_actions(ThunarxMenuProvider *provider, G_GNUC_UN
         }
     }
 
+    g_free(states);
+
     // if there any unsynced files / folders selected
     if (unsyncedFiles || unsyncedFolders) 
     {
@@ -417,3 +399,78 @@ static gboolean mega_ext_path_in_sync(MEGAExt *mega_ext, const gchar *path)
 
     return found;
 }
+
+// returns a new array with the state of each file, FILE_ERROR if it couldn't be retrieved.
+// The files in synced folders are sent to MEGAsync in a single batch request
+static FileState *mega_ext_get_files_states(MEGAExt *mega_ext, GList *files)
+{
+    GList *l;
+    GPtrArray *paths;
+    GArray *indexes;
+    FileState *states, *batch_states;
+    guint i;
+
+    states = g_new(FileState, g_list_length(files));
+    paths = g_ptr_array_new_with_free_func(g_free);
+    indexes = g_array_new(FALSE, FALSE, sizeof(guint));
+
+    for (l = files, i = 0; l != NULL; l = l->next, i++)
+    {
+        ThunarxFileInfo *file = THUNARX_FILE_INFO(l->data);
+        gchar *path;
+        GFile *fp;
+
+        states[i] = FILE_ERROR;
+        fp = thunarx_file_info_get_location(file);
+        if (!fp)
+        {
+            continue;
+        }
+
+        path = g_file_get_path(fp);
+        g_object_unref(fp);
+        if (!path)
+        {
+            continue;
+        }
+
+        // avoid sending requests for files which are not in synced folders
+        // but make sure we received the list of synced folders first
+        if (mega_ext->syncs_received && !mega_ext_path_in_sync(mega_ext, path))
+        {
+            states[i] = FILE_NOTFOUND;
+            g_free(path);
+        }
+        else if (strchr(path, '\n'))
+        {
+            // newlines are used as request terminators, the state can't be requested
+            g_free(path);
+        }
+        else
+        {
+            g_ptr_array_add(paths, path);
+            g_array_append_val(indexes, i);
+        }
+    }
+
+    if (paths->len)
+    {
+        batch_states = g_new(FileState, paths->len);
+        for (i = 0; i < paths->len; i++)
+        {
+            batch_states[i] = FILE_ERROR;
+        }
+
+        mega_ext_client_get_path_states(mega_ext, (const gchar **)paths->pdata, paths->len, batch_states);
+        for (i = 0; i < paths->len; i++)
+        {
+            states[g_array_index(indexes, guint, i)] = batch_states[i];
+        }
+        g_free(batch_states);
+    }
+
+    g_array_free(indexes, TRUE);
+    g_ptr_array_free(paths, TRUE);
+
+    return states;
+}
@@ -5,6 +5,7 @@
 #include "gui/QMegaMessageBox.h"
 #include "control/Utilities.h"
 #include "control/CrashHandler.h"
+#include "control/LocalCacheChecker.h"
 #include "control/ExportProcessor.h"
 #include "platform/Platform.h"
 #include "qtlockedfile/qtlockedfile.h"
@@ -381,7 +382,8 @@ int main(int argc, char *argv[])
 }
 
 MegaApplication::MegaApplication(int &argc, char **argv) :
-    QApplication(argc, argv)
+    QApplication(argc, argv),
+    finishedTransfers(Preferences::MAX_COMPLETED_ITEMS)
 {
     appfinished = false;
     logger = new MegaSyncLogger(this);
@@ -474,6 +476,7 @@ MegaApplication::MegaApplication(int &argc, char **argv) :
     megaApiFolders = NULL;
     delegateListener = NULL;
     httpServer = NULL;
+    networkMonitor = NULL;
     numTransfers[MegaTransfer::TYPE_DOWNLOAD] = 0;
     numTransfers[MegaTransfer::TYPE_UPLOAD] = 0;
     exportOps = 0;
@@ -547,6 +550,7 @@ MegaApplication::MegaApplication(int &argc, char **argv) :
     nUnviewedTransfers = 0;
     completedTabActive = false;
     prevVersion = 0;
+    globalStateTimer = NULL;
 
 #ifdef __APPLE__
     scanningTimer = NULL;
@@ -580,6 +584,10 @@ void MegaApplication::initialize()
 
     paused = false;
     indexing = false;
+    lastPendingUploads = 0;
+    lastPendingDownloads = 0;
+    lastPaused = false;
+    lastStateReported = false;
     setQuitOnLastWindowClosed(false);
 
 #ifdef Q_OS_LINUX
@@ -594,6 +602,7 @@ void MegaApplication::initialize()
 
     //Register metatypes to use them in signals/slots
     qRegisterMetaType<QQueue<QString> >("QQueueQString");
+    qRegisterMetaType<NodesUpdateSummary>("NodesUpdateSummary");
     qRegisterMetaTypeStreamOperators<QQueue<QString> >("QQueueQString");
 
     preferences = Preferences::instance();
@@ -663,29 +672,36 @@ void MegaApplication::initialize()
     delegateListener = new MEGASyncDelegateListener(megaApi, this, this);
     megaApi->addListener(delegateListener);
     uploader = new MegaUploader(megaApi);
+    connect(uploader, SIGNAL(progress(int, long long, long long)), this, SLOT(onUploadPreparationProgress(int, long long, long long)));
+    connect(uploader, SIGNAL(preparationFinished()), this, SLOT(onUploadPreparationFinished()));
+    connect(uploader, SIGNAL(localCopyProgress(long long, long long)), this, SLOT(onLocalCopyProgress(long long, long long)));
+    connect(uploader, SIGNAL(localCopyFinished(bool)), this, SLOT(onLocalCopyFinished(bool)));
     downloader = new MegaDownloader(megaApi);
+    connect(downloader, SIGNAL(estimate(long long, long long)), this, SLOT(onDownloadEstimate(long long, long long)));
+    connect(downloader, SIGNAL(preparationFinished()), this, SLOT(onDownloadPreparationFinished()));
 
     connectivityTimer = new QTimer(this);
     connectivityTimer->setSingleShot(true);
     connectivityTimer->setInterval(Preferences::MAX_LOGIN_TIME_MS);
     connect(connectivityTimer, SIGNAL(timeout()), this, SLOT(runConnectivityCheck()));
 
-    if (preferences->isCrashed())
+    bool crashed = preferences->isCrashed();
+    bool cacheCheckNeeded = preferences->isCacheCheckNeeded();
+    if (crashed)
     {
+        // a reload of the filesystem was requested
         preferences->setCrashed(false);
-        QDirIterator di(dataPath, QDir::Files | QDir::NoDotAndDotDot);
-        while (di.hasNext())
-        {
-            di.next();
-            const QFileInfo& fi = di.fileInfo();
-            if (fi.fileName().endsWith(QString::fromAscii(".db"))
-                    || fi.fileName().endsWith(QString::fromAscii(".db-wal"))
-                    || fi.fileName().endsWith(QString::fromAscii(".db-shm")))
-            {
-                QFile::remove(di.filePath());
-            }
-        }
+        preferences->setCacheCheckNeeded(false);
+        LocalCacheChecker::removeCaches(dataPath);
+    }
+    else if (cacheCheckNeeded)
+    {
+        preferences->setCacheCheckNeeded(false);
+        LocalCacheChecker::checkCaches(dataPath);
+    }
 
+    if (crashed || cacheCheckNeeded)
+    {
         QStringList reports = CrashHandler::instance()->getPendingCrashReports();
         if (reports.size())
         {
@@ -705,10 +721,21 @@ void MegaApplication::initialize()
     periodicTasksTimer->start(Preferences::STATE_REFRESH_INTERVAL_MS);
     connect(periodicTasksTimer, SIGNAL(timeout()), this, SLOT(periodicTasks()));
 
+    // network changes are checked as soon as they happen if the system notifies them,
+    // otherwise the interfaces are polled in periodicTasks
+    networkMonitor = new NetworkMonitor(this);
+    connect(networkMonitor, SIGNAL(networkChanged()), this, SLOT(checkNetworkInterfaces()));
+    networkMonitor->start();
+
     infoDialogTimer = new QTimer(this);
     infoDialogTimer->setSingleShot(true);
     connect(infoDialogTimer, SIGNAL(timeout()), this, SLOT(showInfoDialog()));
 
+    globalStateTimer = new QTimer(this);
+    globalStateTimer->setSingleShot(true);
+    globalStateTimer->setInterval(Preferences::GLOBAL_STATE_UPDATE_INTERVAL_MS);
+    connect(globalStateTimer, SIGNAL(timeout()), this, SLOT(updateGlobalState()));
+
     firstTransferTimer = new QTimer(this);
     firstTransferTimer->setSingleShot(true);
     firstTransferTimer->setInterval(200);
@@ -1049,6 +1076,24 @@ void MegaApplication::updateTrayIcon()
 #endif
     }
 
+    if (!uploadPreparationStatus.isEmpty())
+    {
+        tooltip += QString::fromAscii("\n")
+                + uploadPreparationStatus;
+    }
+
+    if (!downloadPreparationStatus.isEmpty())
+    {
+        tooltip += QString::fromAscii("\n")
+                + downloadPreparationStatus;
+    }
+
+    if (!localCopyStatus.isEmpty())
+    {
+        tooltip += QString::fromAscii("\n")
+                + localCopyStatus;
+    }
+
     if (updateAvailable)
     {
         tooltip += QString::fromAscii("\n")
@@ -1574,6 +1619,7 @@ void MegaApplication::rebootApplication(bool update)
 
 #ifdef __APPLE__
     cleanAll();
+    preferences->flush();
     ::exit(0);
 #endif
 
@@ -1910,12 +1956,18 @@ void MegaApplication::periodicTasks()
         megaApi->getAccountDetails();
     }
 
-    checkNetworkInterfaces();
-
     static int counter = 0;
+    counter++;
+
+    // with notifications, polling is only a safety net
+    if (!networkMonitor || !networkMonitor->isActive() || !(counter % 6))
+    {
+        checkNetworkInterfaces();
+    }
+
     if (megaApi)
     {
-        if (!(++counter % 6))
+        if (!(counter % 6))
         {
             if (checkupdate)
             {
@@ -1963,6 +2015,10 @@ void MegaApplication::cleanAll()
 #endif
 
     periodicTasksTimer->stop();
+    if (networkMonitor)
+    {
+        networkMonitor->stop();
+    }
     stopUpdateTask();
     Platform::stopShellDispatcher();
     for (int i = 0; i < preferences->getNumSyncedFolders(); i++)
@@ -2017,6 +2073,8 @@ void MegaApplication::cleanAll()
     megaApiFolders = NULL;
 
     preferences->setLastExit(QDateTime::currentMSecsSinceEpoch());
+    // pending changes would be lost with the process
+    preferences->flush();
     trayIcon->deleteLater();
     trayIcon = NULL;
 
@@ -2949,6 +3007,83 @@ void MegaApplication::onDeprecatedOperatingSystem()
 #endif
 }
 
+void MegaApplication::onUploadPreparationProgress(int stage, long long done, long long total)
+{
+    QString count = (total < 0) ? QString::number(done)
+                                : QString::fromUtf8("%1/%2").arg(done).arg(total);
+    switch (stage)
+    {
+        case MegaUploader::STAGE_SCANNING:
+            uploadPreparationStatus = tr("Preparing upload: scanning (%1)").arg(count);
+            break;
+        case MegaUploader::STAGE_CREATING_FOLDERS:
+            uploadPreparationStatus = tr("Preparing upload: creating folders (%1)").arg(count);
+            break;
+        default:
+            uploadPreparationStatus = tr("Preparing upload: adding files (%1)").arg(count);
+            break;
+    }
+    updateTrayIcon();
+}
+
+void MegaApplication::onUploadPreparationFinished()
+{
+    uploadPreparationStatus.clear();
+    updateTrayIcon();
+}
+
+void MegaApplication::onDownloadEstimate(long long numFiles, long long numBytes)
+{
+    if (numFiles < 0)
+    {
+        downloadPreparationStatus = tr("Preparing download: %1").arg(Utilities::getSizeString(numBytes));
+    }
+    else
+    {
+        downloadPreparationStatus = tr("Preparing download: %1 files, %2")
+                .arg(numFiles).arg(Utilities::getSizeString(numBytes));
+    }
+    MegaApi::log(MegaApi::LOG_LEVEL_INFO, downloadPreparationStatus.toUtf8().constData());
+    updateTrayIcon();
+}
+
+void MegaApplication::onDownloadPreparationFinished()
+{
+    downloadPreparationStatus.clear();
+    updateTrayIcon();
+}
+
+void MegaApplication::onLocalCopyProgress(long long copiedBytes, long long totalBytes)
+{
+    localCopyStatus = tr("Copying to synced folder: %1 of %2")
+            .arg(Utilities::getSizeString(copiedBytes))
+            .arg(Utilities::getSizeString(totalBytes));
+    updateTrayIcon();
+}
+
+void MegaApplication::onLocalCopyFinished(bool cancelled)
+{
+    localCopyStatus.clear();
+    updateTrayIcon();
+    if (cancelled)
+    {
+        showInfoMessage(tr("Copy to synced folder canceled"));
+    }
+}
+
+void MegaApplication::cancelLocalCopies()
+{
+    if (uploader)
+    {
+        uploader->cancelLocalCopies();
+    }
+}
+
+long long MegaApplication::getLastExit()
+{
+    return lastExit;
+}
+
 int MegaApplication::getPrevVersion()
 {
     return prevVersion;
@@ -3089,32 +3224,18 @@ void MegaApplication::toggleLogging()
 
 void MegaApplication::removeFinishedTransfer(int transferTag)
 {
-    QMap<int, MegaTransfer*>::iterator it = finishedTransfers.find(transferTag);
-    if (it != finishedTransfers.end())
-    {     
-        for (QList<MegaTransfer*>::iterator it2 = finishedTransferOrder.begin(); it2 != finishedTransferOrder.end(); it2++)
-        {
-            if ((*it2)->getTag() == transferTag)
-            {
-                finishedTransferOrder.erase(it2);
-                break;
-            }
-        }
-        delete it.value();
-        finishedTransfers.erase(it);
-    }
+    delete finishedTransfers.take(transferTag);
 }
 
 void MegaApplication::removeAllFinishedTransfers()
 {
-    qDeleteAll(finishedTransfers);
-    finishedTransferOrder.clear();
+    qDeleteAll(finishedTransfers.values());
     finishedTransfers.clear();
 }
 
 QList<MegaTransfer*> MegaApplication::getFinishedTransfers()
 {
-    return finishedTransferOrder;
+    return finishedTransfers.values();
 }
 
 int MegaApplication::getNumUnviewedTransfers()
@@ -3124,10 +3245,6 @@ int MegaApplication::getNumUnviewedTransfers()
 
 MegaTransfer* MegaApplication::getFinishedTransferByTag(int tag)
 {
-    if (!finishedTransfers.contains(tag))
-    {
-        return NULL;
-    }
     return finishedTransfers.value(tag);
 }
 
@@ -5546,15 +5663,18 @@ void MegaApplication::onTransferFinish(MegaApi* , MegaTransfer *transfer, MegaEr
     if (transfer->getState() == MegaTransfer::STATE_COMPLETED || transfer->getState() == MegaTransfer::STATE_FAILED)
     {
         MegaTransfer *t = transfer->copy();
-        if (finishedTransfers.count(transfer->getTag()))
+        if (finishedTransfers.contains(transfer->getTag()))
         {
             assert(false);
             megaApi->sendEvent(99512, QString::fromUtf8("Duplicated finished transfer: %1").arg(QString::number(transfer->getTag())).toUtf8().constData());
             removeFinishedTransfer(transfer->getTag());
         }
 
-        finishedTransfers.insert(transfer->getTag(), t);
-        finishedTransferOrder.push_back(t);
+        if (finishedTransfers.isFull())
+        {
+            delete finishedTransfers.takeOldest();
+        }
+        finishedTransfers.push(transfer->getTag(), t);
 
         if (!transferManager)
         {
@@ -5577,11 +5697,6 @@ void MegaApplication::onTransferFinish(MegaApi* , MegaTransfer *transfer, MegaEr
         transferManager->onTransferFinish(megaApi, transfer, e);
     }
 
-    if (finishedTransferOrder.size() > Preferences::MAX_COMPLETED_ITEMS)
-    {
-        removeFinishedTransfer(finishedTransferOrder.first()->getTag());
-    }
-
     //Show the transfer in the "recently updated" list
     if (e->getErrorCode() == MegaError::API_OK && transfer->getNodeHandle() != INVALID_HANDLE)
     {
@@ -5867,75 +5982,40 @@ void MegaApplication::onUsersUpdate(MegaApi* , MegaUserList *)
 //Called when nodes have been updated in MEGA
 void MegaApplication::onNodesUpdate(MegaApi* , MegaNodeList *nodes)
 {
-    if (appfinished || !infoDialog || !nodes || !preferences->logged())
+    // updates are normally summarized in the SDK thread by MEGASyncDelegateListener
+    if (appfinished || !nodes)
     {
         return;
     }
 
-    bool externalNodes = 0;
-    bool nodesRemoved = false;
-    long long usedStorage = preferences->usedStorage();
+    processNodesUpdate(summarizeNodes(nodes, lastExit));
+}
+
+NodesUpdateSummary MegaApplication::summarizeNodes(MegaNodeList *nodes, long long lastExit)
+{
+    NodesUpdateSummary summary;
     MegaApi::log(MegaApi::LOG_LEVEL_INFO, QString::fromUtf8("%1 updated files/folders").arg(nodes->size()).toUtf8().constData());
 
-    //Check all modified nodes
-    QString localPath;
+    QMultiHash<MegaHandle, int> syncRoots = Preferences::instance()->getActiveSyncRoots();
     for (int i = 0; i < nodes->size(); i++)
     {
-        localPath.clear();
         MegaNode *node = nodes->get(i);
-
-        for (int i = 0; i < preferences->getNumSyncedFolders(); i++)
+        if (node->getType() == MegaNode::TYPE_FOLDER && syncRoots.contains(node->getHandle()))
         {
-            if (!preferences->isFolderActive(i))
-            {
-                continue;
-            }
-
-            if (node->getType() == MegaNode::TYPE_FOLDER
-                    && (node->getHandle() == preferences->getMegaFolderHandle(i)))
-            {
-                MegaNode *nodeByHandle = megaApi->getNodeByHandle(preferences->getMegaFolderHandle(i));
-                const char *nodePath = megaApi->getNodePath(nodeByHandle);
-
-                if (!nodePath || preferences->getMegaFolder(i).compare(QString::fromUtf8(nodePath)))
-                {
-                    if (nodePath && QString::fromUtf8(nodePath).startsWith(QString::fromUtf8("//bin")))
-                    {
-                        showErrorMessage(tr("Your sync \"%1\" has been disabled because the remote folder is in the rubbish bin")
-                                         .arg(preferences->getSyncName(i)));
-                    }
-                    else
-                    {
-                        showErrorMessage(tr("Your sync \"%1\" has been disabled because the remote folder doesn't exist")
-                                         .arg(preferences->getSyncName(i)));
-                    }
-                    Platform::syncFolderRemoved(preferences->getLocalFolder(i),
-                                                preferences->getSyncName(i),
-                                                preferences->getSyncID(i));
-                    Platform::notifyItemChange(preferences->getLocalFolder(i));
-                    MegaNode *node = megaApi->getNodeByHandle(preferences->getMegaFolderHandle(i));
-                    megaApi->removeSync(node);
-                    delete node;
-                    preferences->setSyncState(i, false);
-                    openSettings(SettingsDialog::SYNCS_TAB);
-                }
-
-                delete nodeByHandle;
-                delete [] nodePath;
-            }
+            summary.syncRoots.append(node->getHandle());
         }
 
         if (!node->getTag() && !node->isRemoved()
                 && !node->isSyncDeleted()
                 && ((lastExit / 1000) < node->getCreationTime()))
         {
-            externalNodes++;
+            summary.externalNodes = true;
         }
 
         if (node->isRemoved() && (node->getType() == MegaNode::TYPE_FILE))
         {
-            usedStorage -= node->getSize();
-            nodesRemoved = true;
+            summary.removedBytes += node->getSize();
+            summary.nodesRemoved = true;
         }
 
         if (!node->isRemoved() && node->getTag()
@@ -5943,32 +6023,90 @@ void MegaApplication::onNodesUpdate(MegaApi* , MegaNodeList *nodes)
                 && (node->getType() == MegaNode::TYPE_FILE)
                 && node->getAttrString()->size())
         {
-            //NO_KEY node created by this client detected
-            if (!noKeyDetected)
+            summary.noKeyNodes++;
+        }
+    }
+    return summary;
+}
+
+void MegaApplication::processNodesUpdate(NodesUpdateSummary summary)
+{
+    if (appfinished || !infoDialog || !preferences->logged())
+    {
+        return;
+    }
+
+    //Check the remote folders of the syncs
+    QMultiHash<MegaHandle, int> syncRoots = preferences->getActiveSyncRoots();
+    for (int k = 0; k < summary.syncRoots.size(); k++)
+    {
+        QList<int> syncs = syncRoots.values(summary.syncRoots.at(k));
+        for (int j = 0; j < syncs.size(); j++)
+        {
+            int i = syncs.at(j);
+            if (!preferences->isFolderActive(i))
             {
-                if (megaApi->isLoggedIn())
+                continue;
+            }
+
+            MegaNode *nodeByHandle = megaApi->getNodeByHandle(preferences->getMegaFolderHandle(i));
+            const char *nodePath = megaApi->getNodePath(nodeByHandle);
+
+            if (!nodePath || preferences->getMegaFolder(i).compare(QString::fromUtf8(nodePath)))
+            {
+                if (nodePath && QString::fromUtf8(nodePath).startsWith(QString::fromUtf8("//bin")))
                 {
-                    megaApi->fetchNodes();
+                    showErrorMessage(tr("Your sync \"%1\" has been disabled because the remote folder is in the rubbish bin")
+                                     .arg(preferences->getSyncName(i)));
+                }
+                else
+                {
+                    showErrorMessage(tr("Your sync \"%1\" has been disabled because the remote folder doesn't exist")
+                                     .arg(preferences->getSyncName(i)));
                 }
+                Platform::syncFolderRemoved(preferences->getLocalFolder(i),
+                                            preferences->getSyncName(i),
+                                            preferences->getSyncID(i));
+                Platform::notifyItemChange(preferences->getLocalFolder(i));
+                MegaNode *node = megaApi->getNodeByHandle(preferences->getMegaFolderHandle(i));
+                megaApi->removeSync(node);
+                delete node;
+                preferences->setSyncState(i, false);
+                openSettings(SettingsDialog::SYNCS_TAB);
             }
-            else if (noKeyDetected > 20)
+
+            delete nodeByHandle;
+            delete [] nodePath;
+        }
+    }
+
+    for (int i = 0; i < summary.noKeyNodes; i++)
+    {
+        //NO_KEY node created by this client detected
+        if (!noKeyDetected)
+        {
+            if (megaApi->isLoggedIn())
             {
-                QMegaMessageBox::critical(NULL, QString::fromUtf8("MEGAsync"),
-                    QString::fromUtf8("Something went wrong. MEGAsync will restart now. If the problem persists please contact bug@mega.co.nz"), Utilities::getDevicePixelRatio());
-                preferences->setCrashed(true);
-                rebootApplication(false);
+                megaApi->fetchNodes();
             }
-            noKeyDetected++;
         }
+        else if (noKeyDetected > 20)
+        {
+            QMegaMessageBox::critical(NULL, QString::fromUtf8("MEGAsync"),
+                QString::fromUtf8("Something went wrong. MEGAsync will restart now. If the problem persists please contact bug@mega.co.nz"), Utilities::getDevicePixelRatio());
+            preferences->setCrashed(true);
+            rebootApplication(false);
+        }
+        noKeyDetected++;
     }
 
-    if (nodesRemoved)
+    if (summary.nodesRemoved)
     {
-        preferences->setUsedStorage(usedStorage);
+        preferences->setUsedStorage(preferences->usedStorage() - summary.removedBytes);
         updateUserStats();
     }
 
-    if (externalNodes)
+    if (summary.externalNodes)
     {
         updateUserStats();
         if (QDateTime::currentMSecsSinceEpoch() - externalNodesTimestamp > Preferences::MIN_EXTERNAL_NODES_WARNING_MS)
@@ -5999,29 +6137,61 @@ void MegaApplication::onGlobalSyncStateChanged(MegaApi *)
         return;
     }
 
-    if (megaApi && infoDialog)
+    // bursts of transfer and sync events are applied only once
+    if (!globalStateTimer)
+    {
+        updateGlobalState();
+    }
+    else if (!globalStateTimer->isActive())
     {
-        indexing = megaApi->isScanning();
-        waiting = megaApi->isWaiting();
+        globalStateTimer->start();
+    }
+}
+
+void MegaApplication::updateGlobalState()
+{
+    if (appfinished)
+    {
+        return;
+    }
 
+    bool stateChanged = !lastStateReported || paused != lastPaused;
+    if (megaApi && infoDialog)
+    {
+        bool newIndexing = megaApi->isScanning();
+        bool newWaiting = megaApi->isWaiting();
         int pendingUploads = megaApi->getNumPendingUploads();
         int pendingDownloads = megaApi->getNumPendingDownloads();
-        if (pendingUploads)
-        {
-            MegaApi::log(MegaApi::LOG_LEVEL_INFO, QString::fromUtf8("Pending uploads: %1").arg(pendingUploads).toUtf8().constData());
-        }
 
-        if (pendingDownloads)
+        stateChanged = stateChanged || newIndexing != indexing || newWaiting != waiting;
+        bool changed = stateChanged || pendingUploads != lastPendingUploads || pendingDownloads != lastPendingDownloads;
+        indexing = newIndexing;
+        waiting = newWaiting;
+
+        if (changed)
         {
-            MegaApi::log(MegaApi::LOG_LEVEL_INFO, QString::fromUtf8("Pending downloads: %1").arg(pendingDownloads).toUtf8().constData());
+            if (pendingUploads != lastPendingUploads && pendingUploads)
+            {
+                MegaApi::log(MegaApi::LOG_LEVEL_INFO, QString::fromUtf8("Pending uploads: %1").arg(pendingUploads).toUtf8().constData());
+            }
+
+            if (pendingDownloads != lastPendingDownloads && pendingDownloads)
+            {
+                MegaApi::log(MegaApi::LOG_LEVEL_INFO, QString::fromUtf8("Pending downloads: %1").arg(pendingDownloads).toUtf8().constData());
+            }
         }
 
         infoDialog->setIndexing(indexing);
         infoDialog->setWaiting(waiting);
         infoDialog->setPaused(paused);
         infoDialog->updateState();
-        infoDialog->transferFinished(MegaError::API_OK);
+        if (changed)
+        {
+            infoDialog->transferFinished(MegaError::API_OK);
+        }
         infoDialog->updateRecentFiles();
+        lastPendingUploads = pendingUploads;
+        lastPendingDownloads = pendingDownloads;
     }
 
     if (transferManager)
@@ -6029,8 +6199,13 @@ void MegaApplication::onGlobalSyncStateChanged(MegaApi *)
         transferManager->updateState();
     }
 
-    MegaApi::log(MegaApi::LOG_LEVEL_INFO, QString::fromUtf8("Current state. Paused = %1   Indexing = %2   Waiting = %3")
-                 .arg(paused).arg(indexing).arg(waiting).toUtf8().constData());
+    if (stateChanged)
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_INFO, QString::fromUtf8("Current state. Paused = %1   Indexing = %2   Waiting = %3")
+                     .arg(paused).arg(indexing).arg(waiting).toUtf8().constData());
+    }
+    lastPaused = paused;
+    lastStateReported = true;
 
     if (!isLinux)
     {
@@ -6065,6 +6240,19 @@ MEGASyncDelegateListener::MEGASyncDelegateListener(MegaApi *megaApi, MegaListene
     this->app = app;
 }
 
+void MEGASyncDelegateListener::onNodesUpdate(MegaApi *, MegaNodeList *nodes)
+{
+    if (!app || !nodes)
+    {
+        return;
+    }
+
+    // big lists of nodes are processed here instead of being copied to the GUI thread
+    NodesUpdateSummary summary = MegaApplication::summarizeNodes(nodes, app->getLastExit());
+    QMetaObject::invokeMethod(app, "processNodesUpdate", Qt::QueuedConnection,
+                              Q_ARG(NodesUpdateSummary, summary));
+}
+
 void MEGASyncDelegateListener::onRequestFinish(MegaApi *api, MegaRequest *request, MegaError *e)
 {
     QTMegaListener::onRequestFinish(api, request, e);
@@ -14,6 +14,7 @@
 #include <QNetworkInterface>
 
 #include "gui/TransferManager.h"
+#include "gui/TransferRingBuffer.h"
 #include "gui/NodeSelector.h"
 #include "gui/InfoDialog.h"
 #include "gui/InfoOverQuotaDialog.h"
@@ -32,6 +33,7 @@
 #include "control/HTTPServer.h"
 #include "control/MegaUploader.h"
 #include "control/MegaDownloader.h"
+#include "control/NetworkMonitor.h"
 #include "control/UpdateTask.h"
 #include "control/MegaSyncLogger.h"
 #include "megaapi.h"
@@ -44,6 +46,20 @@
 
 Q_DECLARE_METATYPE(QQueue<QString>)
 
+// What the app needs from a onNodesUpdate callback, computed in the SDK thread
+struct NodesUpdateSummary
+{
+    NodesUpdateSummary() : externalNodes(false), nodesRemoved(false), removedBytes(0), noKeyNodes(0) {}
+
+    bool externalNodes;
+    bool nodesRemoved;
+    long long removedBytes;
+    int noKeyNodes;
+    // updated remote folders of active syncs
+    QList<mega::MegaHandle> syncRoots;
+};
+Q_DECLARE_METATYPE(NodesUpdateSummary)
+
 class Notificator;
 class MEGASyncDelegateListener;
 
@@ -104,6 +120,9 @@ public:
     void removeFinishedTransfer(int transferTag);
     void removeAllFinishedTransfers();
     mega::MegaTransfer* getFinishedTransferByTag(int tag);
+    void cancelLocalCopies();
+    long long getLastExit();
+    static NodesUpdateSummary summarizeNodes(mega::MegaNodeList *nodes, long long lastExit);
 
 signals:
     void startUpdaterThread();
@@ -112,6 +131,7 @@ signals:
     void unityFixSignal();
 
 public slots:
+    void processNodesUpdate(NodesUpdateSummary summary);
     void showInterface(QString);
     void trayIconActivated(QSystemTrayIcon::ActivationReason reason);
     void onMessageClicked();
@@ -151,6 +171,7 @@ public slots:
     void checkNetworkInterfaces();
     void checkMemoryUsage();
     void periodicTasks();
+    void updateGlobalState();
     void cleanAll();
     void onDupplicateLink(QString link, QString name, mega::MegaHandle handle);
     void onInstallUpdateClicked();
@@ -174,6 +195,12 @@ public slots:
     void onCompletedTransfersTabActive(bool active);
     void checkFirstTransfer();
     void onDeprecatedOperatingSystem();
+    void onUploadPreparationProgress(int stage, long long done, long long total);
+    void onUploadPreparationFinished();
+    void onDownloadEstimate(long long numFiles, long long numBytes);
+    void onDownloadPreparationFinished();
+    void onLocalCopyProgress(long long copiedBytes, long long totalBytes);
+    void onLocalCopyFinished(bool cancelled);
     int getPrevVersion();
 
 protected:
@@ -282,6 +309,8 @@ protected:
     QTimer *periodicTasksTimer;
     QTimer *infoDialogTimer;
     QTimer *firstTransferTimer;
+    // state changes are accumulated and applied by this timer
+    QTimer *globalStateTimer;
     QTranslator translator;
     PasteMegaLinksDialog *pasteMegaLinksDialog;
     ChangeLogDialog *changeLogDialog;
@@ -301,24 +330,31 @@ protected:
     Notificator *notificator;
     long long lastActiveTime;
     QNetworkConfigurationManager networkConfigurationManager;
+    NetworkMonitor *networkMonitor;
     QList<QNetworkInterface> activeNetworkInterfaces;
     QMap<QString, QString> pendingLinks;
     MegaSyncLogger *logger;
     QPointer<TransferManager> transferManager;
-    QMap<int, mega::MegaTransfer*> finishedTransfers;
-    QList<mega::MegaTransfer*> finishedTransferOrder;
+    TransferRingBuffer<mega::MegaTransfer*> finishedTransfers;
 
     bool reboot;
     bool syncActive;
     bool paused;
     bool indexing;
     bool waiting;
+    int lastPendingUploads;
+    int lastPendingDownloads;
+    bool lastPaused;
+    bool lastStateReported;
     bool updated;
     bool checkupdate;
     bool updateBlocked;
     long long lastExit;
     bool appfinished;
     bool updateAvailable;
+    QString uploadPreparationStatus;
+    QString downloadPreparationStatus;
+    QString localCopyStatus;
     bool isLinux;
     long long externalNodesTimestamp;
     bool overquotaCheck;
@@ -336,6 +372,7 @@ class MEGASyncDelegateListener: public mega::QTMegaListener
 public:
     MEGASyncDelegateListener(mega::MegaApi *megaApi, mega::MegaListener *parent = NULL, MegaApplication *app = NULL);
     virtual void onRequestFinish(mega::MegaApi* api, mega::MegaRequest *request, mega::MegaError* e);
+    virtual void onNodesUpdate(mega::MegaApi* api, mega::MegaNodeList *nodes);
 
 protected:
     MegaApplication *app;
@@ -260,12 +260,24 @@ CrashHandler* CrashHandler::instance()
 void CrashHandler::tryReboot()
 {
     Preferences *preferences = Preferences::instance();
-    preferences->setCrashed(true);
+    bool canReboot = (QDateTime::currentMSecsSinceEpoch()-preferences->getLastReboot()) > Preferences::MIN_REBOOT_INTERVAL_MS;
+    if (canReboot)
+    {
+        // the local caches are kept if they are still valid
+        preferences->setCacheCheckNeeded(true);
+    }
+    else
+    {
+        // repeated crashes, the local caches could be the cause
+        preferences->setCrashed(true);
+    }
 
-    if ((QDateTime::currentMSecsSinceEpoch()-preferences->getLastReboot()) > Preferences::MIN_REBOOT_INTERVAL_MS)
+    if (canReboot)
     {
         MegaApi::log(MegaApi::LOG_LEVEL_WARNING, "Restarting app...");
         preferences->setLastReboot(QDateTime::currentMSecsSinceEpoch());
+        // the new instance reads these flags as soon as it starts
+        preferences->flush();
 
 #ifndef __APPLE__
         QString app = MegaApplication::applicationFilePath();
@@ -0,0 +1,298 @@
+#include "DirectoryStats.h"
+#include "Preferences.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSemaphore>
+#include <QVector>
+#include <QRunnable>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// The cache is dropped when it has more folders than this
+#define MAX_CACHED_FOLDERS 1000000
+// Folders modified this recently aren't cached, because filesystems with low time
+// resolution could modify them again without changing their modification time
+#define MIN_FOLDER_AGE_NS (2000LL * 1000 * 1000)
+#define DIRENT_BUFFER_SIZE (64 * 1024)
+
+Q_GLOBAL_STATIC(DirectoryStats, directoryStats)
+
+class DirectoryStats::FolderTask : public QRunnable
+{
+public:
+    FolderTask(DirectoryStats *stats, QString path, CachedFolder *folder, bool *ok, QSemaphore *done)
+    {
+        this->stats = stats;
+        this->path = path;
+        this->folder = folder;
+        this->ok = ok;
+        this->done = done;
+        setAutoDelete(true);
+    }
+
+    void run()
+    {
+        stats->processFolder(path, folder, ok);
+        done->release();
+    }
+
+protected:
+    DirectoryStats *stats;
+    QString path;
+    CachedFolder *folder;
+    bool *ok;
+    QSemaphore *done;
+};
+
+DirectoryStats::DirectoryStats()
+{
+    pool.setMaxThreadCount(Preferences::MAX_DIRECTORY_STATS_THREADS);
+}
+
+DirectoryStats *DirectoryStats::instance()
+{
+    return directoryStats();
+}
+
+DirectoryStats::Totals DirectoryStats::stats(QString path)
+{
+    Totals totals;
+    if (!path.size())
+    {
+        return totals;
+    }
+
+    QStringList level;
+    level.append(QDir::cleanPath(path));
+    while (!level.isEmpty())
+    {
+        QVector<CachedFolder> folders(level.size());
+        QVector<bool> ok(level.size());
+        QSemaphore done;
+        for (int i = 0; i < level.size(); i++)
+        {
+            pool.start(new FolderTask(this, level.at(i), &folders[i], &ok[i], &done));
+        }
+        done.acquire(level.size());
+
+        QStringList nextLevel;
+        for (int i = 0; i < level.size(); i++)
+        {
+            if (!ok.at(i))
+            {
+                continue;
+            }
+
+            const CachedFolder &folder = folders.at(i);
+            totals.size += folder.size;
+            totals.numFiles += folder.numFiles;
+            totals.numFolders += folder.subfolders.size();
+            for (int j = 0; j < folder.subfolders.size(); j++)
+            {
+                nextLevel.append(level.at(i) + QString::fromAscii("/") + folder.subfolders.at(j));
+            }
+        }
+        level = nextLevel;
+    }
+
+    // the folder itself isn't counted
+    return totals;
+}
+
+void DirectoryStats::processFolder(QString path, CachedFolder *folder, bool *ok)
+{
+    long long mtime;
+    if (!getModificationTime(path, &mtime))
+    {
+        *ok = false;
+        return;
+    }
+
+    cacheMutex.lock();
+    QHash<QString, CachedFolder>::const_iterator it = cache.constFind(path);
+    if (it != cache.constEnd() && it.value().mtime == mtime)
+    {
+        *folder = it.value();
+        cacheMutex.unlock();
+        *ok = true;
+        return;
+    }
+    cacheMutex.unlock();
+
+    if (!readFolder(path, folder))
+    {
+        *ok = false;
+        return;
+    }
+    folder->mtime = mtime;
+    *ok = true;
+
+    if (mtime > QDateTime::currentMSecsSinceEpoch() * 1000000LL - MIN_FOLDER_AGE_NS)
+    {
+        return;
+    }
+
+    cacheMutex.lock();
+    if (cache.size() >= MAX_CACHED_FOLDERS)
+    {
+        cache.clear();
+    }
+    cache.insert(path, *folder);
+    cacheMutex.unlock();
+}
+
+bool DirectoryStats::getModificationTime(QString path, long long *mtime)
+{
+#ifdef WIN32
+    QFileInfo info(path);
+    if (!info.isDir())
+    {
+        return false;
+    }
+    *mtime = info.lastModified().toMSecsSinceEpoch() * 1000000LL;
+    return true;
+#else
+    struct stat st;
+    if (lstat(path.toUtf8().constData(), &st) || !S_ISDIR(st.st_mode))
+    {
+        return false;
+    }
+
+#ifdef __APPLE__
+    *mtime = st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    *mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+    return true;
+#endif
+}
+
+#ifdef __linux__
+// glibc doesn't provide a definition of the structure returned by getdents64
+struct linux_dirent64
+{
+    quint64 d_ino;
+    qint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+#endif
+
+bool DirectoryStats::readFolder(QString path, CachedFolder *folder)
+{
+    folder->size = 0;
+    folder->numFiles = 0;
+    folder->subfolders.clear();
+
+#ifdef WIN32
+    // the file information is already included in the results of FindNextFile
+    QDirIterator di(path, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+    while (di.hasNext())
+    {
+        di.next();
+        QFileInfo info = di.fileInfo();
+        if (info.isSymLink())
+        {
+            continue;
+        }
+
+        if (info.isDir())
+        {
+            folder->subfolders.append(di.fileName());
+        }
+        else if (info.isFile())
+        {
+            folder->size += info.size();
+            folder->numFiles++;
+        }
+    }
+    return true;
+#else
+    int fd = open(path.toUtf8().constData(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+#ifdef __linux__
+    // getdents64 returns many entries per call without the overhead of readdir
+    char *buffer = new char[DIRENT_BUFFER_SIZE];
+    long numBytes;
+    while ((numBytes = syscall(SYS_getdents64, fd, buffer, DIRENT_BUFFER_SIZE)) > 0)
+    {
+        for (long pos = 0; pos < numBytes; )
+        {
+            struct linux_dirent64 *entry = (struct linux_dirent64 *)(buffer + pos);
+            addEntry(fd, entry->d_name, entry->d_type, folder);
+            pos += entry->d_reclen;
+        }
+    }
+    delete [] buffer;
+    close(fd);
+    return numBytes == 0;
+#else
+    DIR *dir = fdopendir(fd);
+    if (!dir)
+    {
+        close(fd);
+        return false;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)))
+    {
+        addEntry(fd, entry->d_name, entry->d_type, folder);
+    }
+    closedir(dir);
+    return true;
+#endif
+#endif
+}
+
+#ifndef WIN32
+void DirectoryStats::addEntry(int folderFd, const char *name, unsigned char type, CachedFolder *folder)
+{
+    if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2])))
+    {
+        return;
+    }
+
+    if (type == DT_DIR)
+    {
+        folder->subfolders.append(QString::fromUtf8(name));
+        return;
+    }
+
+    // the type isn't available on all filesystems
+    struct stat st;
+    if ((type != DT_REG && type != DT_UNKNOWN)
+            || fstatat(folderFd, name, &st, AT_SYMLINK_NOFOLLOW))
+    {
+        return;
+    }
+
+    if (S_ISREG(st.st_mode))
+    {
+        folder->size += st.st_size;
+        folder->numFiles++;
+    }
+    else if (S_ISDIR(st.st_mode))
+    {
+        folder->subfolders.append(QString::fromUtf8(name));
+    }
+}
+#endif
@@ -0,0 +1,62 @@
+#ifndef DIRECTORYSTATS_H
+#define DIRECTORYSTATS_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMutex>
+#include <QThreadPool>
+
+/*
+ * Size and number of entries of local folder trees.
+ *
+ * Folders are read in parallel, one level of the tree at a time. The entries of
+ * each folder are cached using the modification time of the folder as the key, so
+ * the next walks only have to stat the folders that haven't changed.
+ * Changes in the size of existing files don't update the modification time of the
+ * folder, so the sizes are accurate for folders whose files are only added or
+ * removed (like the local debris).
+ */
+class DirectoryStats
+{
+public:
+    struct Totals
+    {
+        Totals() : size(0), numFiles(0), numFolders(0) {}
+
+        long long size;
+        long long numFiles;
+        long long numFolders;
+    };
+
+    DirectoryStats();
+    static DirectoryStats *instance();
+
+    // Thread safe. Symbolic links aren't followed
+    Totals stats(QString path);
+
+protected:
+    struct CachedFolder
+    {
+        CachedFolder() : mtime(0), size(0), numFiles(0) {}
+
+        long long mtime;
+        long long size;
+        long long numFiles;
+        QStringList subfolders;
+    };
+
+    class FolderTask;
+    void processFolder(QString path, CachedFolder *folder, bool *ok);
+    static bool readFolder(QString path, CachedFolder *folder);
+    static bool getModificationTime(QString path, long long *mtime);
+#ifndef WIN32
+    static void addEntry(int folderFd, const char *name, unsigned char type, CachedFolder *folder);
+#endif
+
+    QMutex cacheMutex;
+    QHash<QString, CachedFolder> cache;
+    QThreadPool pool;
+};
+
+#endif // DIRECTORYSTATS_H
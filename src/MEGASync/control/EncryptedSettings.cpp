@@ -1,9 +1,36 @@
 #include "EncryptedSettings.h"
 #include "platform/Platform.h"
+#include "megaapi.h"
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QFileInfo>
+#if QT_VERSION >= 0x050000
+#include <QSaveFile>
+#elif !defined(WIN32)
+#include <unistd.h>
+#endif
+
+// Changes are written at most once per interval, in a single write of the settings file
+#define SYNC_INTERVAL_MS 1000
+// Minimum time between two refreshes of the backup file (10 minutes)
+#define BACKUP_INTERVAL_MS 600000
+
+using namespace mega;
 
 EncryptedSettings::EncryptedSettings(QString file) :
     QSettings(file, QSettings::IniFormat)
 {
+    syncPending = false;
+    backupPending = false;
+    bytesWritten = 0;
+    syncTimer.setSingleShot(true);
+    syncTimer.setInterval(SYNC_INTERVAL_MS);
+    connect(&syncTimer, SIGNAL(timeout()), this, SLOT(onSyncTimeout()));
+    if (QCoreApplication::instance())
+    {
+        connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), this, SLOT(flush()));
+    }
+
     QByteArray fixedSeed("$JY/X?o=h·&%v/M(");
     QByteArray localKey = Platform::getLocalStorageKey();
     QByteArray xLocalKey = XOR(fixedSeed, localKey);
@@ -11,48 +38,81 @@ EncryptedSettings::EncryptedSettings(QString file) :
     encryptionKey = hLocalKey;
 }
 
+EncryptedSettings::~EncryptedSettings()
+{
+    flush();
+}
+
 void EncryptedSettings::setValue(const QString &key, const QVariant &value)
 {
-    QSettings::setValue(hash(key), encrypt(key, value.toString()));
+    QMutexLocker locker(&cacheMutex);
+    QString stringValue = value.toString();
+    QSettings::setValue(hash(key), encrypt(key, stringValue));
+
+    CachedValue &cached = cache[cacheKey(key)];
+    cached.present = true;
+    cached.value = stringValue;
 }
 
 QVariant EncryptedSettings::value(const QString &key, const QVariant &defaultValue)
 {
-    return QVariant(decrypt(key, QSettings::value(hash(key), encrypt(key, defaultValue.toString())).toString()));
+    QMutexLocker locker(&cacheMutex);
+    QString ckey = cacheKey(key);
+    QHash<QString, CachedValue>::const_iterator it = cache.constFind(ckey);
+    if (it == cache.constEnd())
+    {
+        CachedValue cached;
+        QString hashedKey = hash(key);
+        cached.present = QSettings::contains(hashedKey);
+        if (cached.present)
+        {
+            cached.value = decrypt(key, QSettings::value(hashedKey).toString());
+        }
+        it = cache.insert(ckey, cached);
+    }
+
+    return QVariant(it.value().present ? it.value().value : defaultValue.toString());
 }
 
 void EncryptedSettings::beginGroup(const QString &prefix)
 {
+    QMutexLocker locker(&cacheMutex);
     QSettings::beginGroup(hash(prefix));
 }
 
 void EncryptedSettings::beginGroup(int numGroup)
 {
-     QSettings::beginGroup(QSettings::childGroups().at(numGroup));
+    QMutexLocker locker(&cacheMutex);
+    QSettings::beginGroup(QSettings::childGroups().at(numGroup));
 }
 
 void EncryptedSettings::endGroup()
 {
+    QMutexLocker locker(&cacheMutex);
     QSettings::endGroup();
 }
 
 int EncryptedSettings::numChildGroups()
 {
+    QMutexLocker locker(&cacheMutex);
     return QSettings::childGroups().size();
 }
 
 bool EncryptedSettings::containsGroup(QString groupName)
 {
+    QMutexLocker locker(&cacheMutex);
     return QSettings::childGroups().contains(hash(groupName));
 }
 
 bool EncryptedSettings::isGroupEmpty()
 {
+    QMutexLocker locker(&cacheMutex);
     return QSettings::group().isEmpty();
 }
 
 void EncryptedSettings::remove(const QString &key)
 {
+    QMutexLocker locker(&cacheMutex);
     if (!key.length())
     {
         QSettings::remove(QString::fromAscii(""));
@@ -61,19 +121,146 @@ void EncryptedSettings::remove(const QString &key)
     {
         QSettings::remove(hash(key));
     }
+
+    // removals can take whole groups with them
+    cache.clear();
 }
 
 void EncryptedSettings::clear()
 {
+    QMutexLocker locker(&cacheMutex);
     QSettings::clear();
+    cache.clear();
 }
 
+// changes are written after a short delay, so several consecutive calls
+// produce a single write of the settings file and its backup
 void EncryptedSettings::sync()
 {
-    QSettings::sync();
+    QMutexLocker locker(&cacheMutex);
+    if (syncPending)
+    {
+        return;
+    }
+
+    syncPending = true;
+    // the timer belongs to the thread of this object
+    QMetaObject::invokeMethod(this, "startSyncTimer", Qt::QueuedConnection);
+}
+
+void EncryptedSettings::startSyncTimer()
+{
+    if (!syncTimer.isActive())
+    {
+        syncTimer.start();
+    }
+}
+
+void EncryptedSettings::flush()
+{
+    writePendingChanges(true);
+}
+
+void EncryptedSettings::onSyncTimeout()
+{
+    writePendingChanges(false);
+}
+
+void EncryptedSettings::writePendingChanges(bool force)
+{
+    QMutexLocker locker(&cacheMutex);
+    // a forced write doesn't depend on a previous call to sync(),
+    // QSettings only writes the file if it has unsaved changes
+    if (syncPending || force)
+    {
+        syncPending = false;
+        syncTimer.stop();
 
-    QFile::remove(this->fileName().append(QString::fromUtf8(".bak")));
-    QFile::copy(this->fileName(),this->fileName().append(QString::fromUtf8(".bak")));
+        // QSettings writes through a temporary file and renames it on Qt5
+        QSettings::sync();
+        bytesWritten += QFileInfo(fileName()).size();
+        backupPending = true;
+    }
+
+    if (backupPending)
+    {
+        updateBackup(force);
+    }
+}
+
+// keep a copy of the last good settings file, but don't rewrite it on every change
+void EncryptedSettings::updateBackup(bool force)
+{
+    if (!force && backupTimer.isValid() && backupTimer.elapsed() < BACKUP_INTERVAL_MS)
+    {
+        return;
+    }
+
+    QFile file(fileName());
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+
+    backupPending = false;
+    QByteArray digest = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    if (digest == backupDigest)
+    {
+        return;
+    }
+
+    if (writeFileAtomically(fileName().append(QString::fromUtf8(".bak")), data))
+    {
+        backupDigest = digest;
+        backupTimer.start();
+        bytesWritten += data.size();
+        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("Settings backup updated. Bytes written since startup: %1")
+                     .arg(bytesWritten).toUtf8().constData());
+    }
+    else
+    {
+        backupPending = true;
+    }
+}
+
+// write to a temporary file, flush it to disk and replace the destination
+bool EncryptedSettings::writeFileAtomically(const QString &path, const QByteArray &data)
+{
+#if QT_VERSION >= 0x050000
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)
+            || file.write(data) != data.size())
+    {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+#else
+    QString tmpPath = path + QString::fromUtf8(".tmp");
+    QFile file(tmpPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || file.write(data) != data.size()
+            || !file.flush())
+    {
+        file.close();
+        QFile::remove(tmpPath);
+        return false;
+    }
+#ifndef WIN32
+    fsync(file.handle());
+#endif
+    file.close();
+
+    QFile::remove(path);
+    return QFile::rename(tmpPath, path);
+#endif
+}
+
+QString EncryptedSettings::cacheKey(const QString &key) const
+{
+    return group() + QString::fromAscii("/") + key;
 }
 
 //Simplified XOR fun
@@ -5,6 +5,10 @@
 #include <QVariant>
 #include <QStringList>
 #include <QCryptographicHash>
+#include <QHash>
+#include <QMutex>
+#include <QTimer>
+#include <QElapsedTimer>
 
 class EncryptedSettings : protected QSettings
 {
@@ -12,6 +16,7 @@ class EncryptedSettings : protected QSettings
 
 public:
     explicit EncryptedSettings(QString file);
+    ~EncryptedSettings();
 
     void setValue(const QString & key, const QVariant & value);
     QVariant value(const QString & key, const QVariant & defaultValue = QVariant());
@@ -25,12 +30,43 @@ public:
     void clear();
     void sync();
 
+public slots:
+    // writes the pending changes and refreshes the backup file now
+    void flush();
+
+private slots:
+    void startSyncTimer();
+    void onSyncTimeout();
+
 protected:
+    struct CachedValue
+    {
+        bool present;
+        QString value;
+    };
+
+    QString cacheKey(const QString &key) const;
+    void writePendingChanges(bool force);
+    void updateBackup(bool force);
+    static bool writeFileAtomically(const QString &path, const QByteArray &data);
+
     QByteArray XOR(const QByteArray &key, const QByteArray& data) const;
     QString encrypt(const QString key, const QString value) const;
     QString decrypt(const QString key, const QString value) const;
     QString hash(const QString key) const;
     QByteArray encryptionKey;
+
+    // decrypted values by group and key, written through on every change
+    QHash<QString, CachedValue> cache;
+    QMutex cacheMutex;
+    QTimer syncTimer;
+    bool syncPending;
+
+    // the backup is refreshed at most once per BACKUP_INTERVAL_MS
+    QElapsedTimer backupTimer;
+    QByteArray backupDigest;
+    bool backupPending;
+    long long bytesWritten;
 };
 
 #endif // ENCRYPTEDSETTINGS_H
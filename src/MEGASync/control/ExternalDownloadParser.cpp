@@ -0,0 +1,587 @@
+#include "ExternalDownloadParser.h"
+#include <QDateTime>
+#include <QString>
+
+// Nesting allowed in values that are skipped
+#define MAX_JSON_DEPTH 64
+#define NODE_KEY_SIZE 43
+
+using namespace mega;
+
+namespace {
+
+// Minimal pull reader over a UTF-8 JSON buffer
+class JSONReader
+{
+public:
+    JSONReader(const QByteArray &json)
+    {
+        pos = json.constData();
+        end = pos + json.size();
+    }
+
+    // Consumes the character c if it's the next one (ignoring whitespace)
+    bool consume(char c)
+    {
+        skipWhitespace();
+        if (pos < end && *pos == c)
+        {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    bool readString(QByteArray &value)
+    {
+        value.clear();
+        if (!consume('"'))
+        {
+            return false;
+        }
+
+        while (pos < end)
+        {
+            // copy the longest run without escapes at once
+            const char *start = pos;
+            while (pos < end && *pos != '"' && *pos != '\\')
+            {
+                pos++;
+            }
+            value.append(start, int(pos - start));
+
+            if (pos >= end)
+            {
+                return false;
+            }
+
+            if (*pos == '"')
+            {
+                pos++;
+                return true;
+            }
+
+            pos++;
+            if (pos >= end)
+            {
+                return false;
+            }
+
+            char c = *pos++;
+            switch (c)
+            {
+                case '"':
+                case '\\':
+                case '/':
+                    value.append(c);
+                    break;
+                case 'b':
+                    value.append('\b');
+                    break;
+                case 'f':
+                    value.append('\f');
+                    break;
+                case 'n':
+                    value.append('\n');
+                    break;
+                case 'r':
+                    value.append('\r');
+                    break;
+                case 't':
+                    value.append('\t');
+                    break;
+                case 'u':
+                {
+                    unsigned int code;
+                    if (!readHex(code))
+                    {
+                        return false;
+                    }
+
+                    if (code >= 0xD800 && code <= 0xDBFF)
+                    {
+                        unsigned int low;
+                        if (end - pos < 2 || pos[0] != '\\' || pos[1] != 'u')
+                        {
+                            return false;
+                        }
+                        pos += 2;
+                        if (!readHex(low) || low < 0xDC00 || low > 0xDFFF)
+                        {
+                            return false;
+                        }
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    else if (code >= 0xDC00 && code <= 0xDFFF)
+                    {
+                        return false;
+                    }
+                    appendUtf8(value, code);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+
+    // Only the integer part of the number is kept
+    bool readNumber(long long &value)
+    {
+        skipWhitespace();
+        bool negative = false;
+        if (pos < end && *pos == '-')
+        {
+            negative = true;
+            pos++;
+        }
+
+        if (pos >= end || *pos < '0' || *pos > '9')
+        {
+            return false;
+        }
+
+        value = 0;
+        while (pos < end && *pos >= '0' && *pos <= '9')
+        {
+            value = value * 10 + (*pos - '0');
+            pos++;
+        }
+
+        if (pos < end && *pos == '.')
+        {
+            pos++;
+            while (pos < end && *pos >= '0' && *pos <= '9')
+            {
+                pos++;
+            }
+        }
+
+        if (pos < end && (*pos == 'e' || *pos == 'E'))
+        {
+            pos++;
+            if (pos < end && (*pos == '+' || *pos == '-'))
+            {
+                pos++;
+            }
+            while (pos < end && *pos >= '0' && *pos <= '9')
+            {
+                pos++;
+            }
+        }
+
+        if (negative)
+        {
+            value = -value;
+        }
+        return true;
+    }
+
+    bool skipValue(int depth = 0)
+    {
+        if (depth > MAX_JSON_DEPTH)
+        {
+            return false;
+        }
+
+        skipWhitespace();
+        if (pos >= end)
+        {
+            return false;
+        }
+
+        switch (*pos)
+        {
+            case '"':
+            {
+                QByteArray ignored;
+                return readString(ignored);
+            }
+            case '{':
+            {
+                pos++;
+                if (consume('}'))
+                {
+                    return true;
+                }
+
+                do
+                {
+                    QByteArray ignored;
+                    if (!readString(ignored) || !consume(':') || !skipValue(depth + 1))
+                    {
+                        return false;
+                    }
+                } while (consume(','));
+                return consume('}');
+            }
+            case '[':
+            {
+                pos++;
+                if (consume(']'))
+                {
+                    return true;
+                }
+
+                do
+                {
+                    if (!skipValue(depth + 1))
+                    {
+                        return false;
+                    }
+                } while (consume(','));
+                return consume(']');
+            }
+            case 't':
+                return readLiteral("true");
+            case 'f':
+                return readLiteral("false");
+            case 'n':
+                return readLiteral("null");
+            default:
+            {
+                long long ignored;
+                return readNumber(ignored);
+            }
+        }
+    }
+
+    bool atEnd()
+    {
+        skipWhitespace();
+        return pos >= end;
+    }
+
+private:
+    void skipWhitespace()
+    {
+        while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r'))
+        {
+            pos++;
+        }
+    }
+
+    bool readLiteral(const char *literal)
+    {
+        while (*literal)
+        {
+            if (pos >= end || *pos != *literal)
+            {
+                return false;
+            }
+            pos++;
+            literal++;
+        }
+        return true;
+    }
+
+    bool readHex(unsigned int &code)
+    {
+        if (end - pos < 4)
+        {
+            return false;
+        }
+
+        code = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            char c = *pos++;
+            code <<= 4;
+            if (c >= '0' && c <= '9')
+            {
+                code |= c - '0';
+            }
+            else if (c >= 'a' && c <= 'f')
+            {
+                code |= c - 'a' + 10;
+            }
+            else if (c >= 'A' && c <= 'F')
+            {
+                code |= c - 'A' + 10;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void appendUtf8(QByteArray &value, unsigned int code)
+    {
+        if (code < 0x80)
+        {
+            value.append(char(code));
+        }
+        else if (code < 0x800)
+        {
+            value.append(char(0xC0 | (code >> 6)));
+            value.append(char(0x80 | (code & 0x3F)));
+        }
+        else if (code < 0x10000)
+        {
+            value.append(char(0xE0 | (code >> 12)));
+            value.append(char(0x80 | ((code >> 6) & 0x3F)));
+            value.append(char(0x80 | (code & 0x3F)));
+        }
+        else
+        {
+            value.append(char(0xF0 | (code >> 18)));
+            value.append(char(0x80 | ((code >> 12) & 0x3F)));
+            value.append(char(0x80 | ((code >> 6) & 0x3F)));
+            value.append(char(0x80 | (code & 0x3F)));
+        }
+    }
+
+    const char *pos;
+    const char *end;
+};
+
+// Fields of an entry of "f"
+struct ForeignNodeEntry
+{
+    ForeignNodeEntry() : type(-1), size(0), mtime(0) {}
+
+    long long type;
+    QByteArray handle;
+    QByteArray name;
+    QByteArray parent;
+    QByteArray key;
+    long long size;
+    long long mtime;
+};
+
+bool readNodeEntry(JSONReader &reader, ForeignNodeEntry &entry)
+{
+    if (!reader.consume('{'))
+    {
+        return false;
+    }
+
+    if (reader.consume('}'))
+    {
+        return true;
+    }
+
+    QByteArray field;
+    do
+    {
+        if (!reader.readString(field) || !reader.consume(':'))
+        {
+            return false;
+        }
+
+        bool ok;
+        if (field == "t")
+        {
+            ok = reader.readNumber(entry.type);
+        }
+        else if (field == "h")
+        {
+            ok = reader.readString(entry.handle);
+        }
+        else if (field == "n")
+        {
+            ok = reader.readString(entry.name);
+        }
+        else if (field == "p")
+        {
+            ok = reader.readString(entry.parent);
+        }
+        else if (field == "k")
+        {
+            ok = reader.readString(entry.key);
+        }
+        else if (field == "s")
+        {
+            ok = reader.readNumber(entry.size);
+        }
+        else if (field == "ts")
+        {
+            ok = reader.readNumber(entry.mtime);
+        }
+        else
+        {
+            ok = reader.skipValue();
+        }
+
+        if (!ok)
+        {
+            return false;
+        }
+    } while (reader.consume(','));
+
+    return reader.consume('}');
+}
+
+// Names are sent in URL-safe base64
+QByteArray decodeName(QByteArray name)
+{
+    name.replace('-', '+');
+    name.replace('_', '/');
+    QByteArray decoded = QByteArray::fromBase64(name);
+    int nul = decoded.indexOf('\0');
+    if (nul >= 0)
+    {
+        decoded.truncate(nul);
+    }
+    return decoded;
+}
+
+bool readNodes(MegaApi *megaApi, JSONReader &reader, const QByteArray &privateAuth,
+               const QByteArray &publicAuth, QQueue<MegaNode *> &nodes)
+{
+    if (!reader.consume('['))
+    {
+        return false;
+    }
+
+    if (reader.consume(']'))
+    {
+        return true;
+    }
+
+    // the first entry is the root of the download, even if it's skipped
+    bool first = true;
+    do
+    {
+        ForeignNodeEntry entry;
+        if (!readNodeEntry(reader, entry))
+        {
+            MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Error parsing webclient request");
+            return false;
+        }
+
+        if (entry.type < 0)
+        {
+            MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without type in webclient request");
+            return false;
+        }
+
+        if (entry.handle.isEmpty())
+        {
+            MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without handle in webclient request");
+            return false;
+        }
+
+        QByteArray name = decodeName(entry.name);
+        if (name.isEmpty())
+        {
+            MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without name in webclient request");
+            return false;
+        }
+
+        MegaHandle h = megaApi->base64ToHandle(entry.handle.constData());
+        MegaHandle p = first ? INVALID_HANDLE : megaApi->base64ToHandle(entry.parent.constData());
+        first = false;
+
+        if (entry.type != MegaNode::TYPE_FILE)
+        {
+            nodes.append(megaApi->createForeignFolderNode(h, name.constData(), p,
+                                                          privateAuth.constData(), publicAuth.constData()));
+        }
+        else if (entry.key.size() == NODE_KEY_SIZE)
+        {
+            nodes.append(megaApi->createForeignFileNode(h, entry.key.constData(), name.constData(),
+                                                        entry.size, entry.mtime, p,
+                                                        privateAuth.constData(), publicAuth.constData()));
+        }
+        else
+        {
+            MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without key (or an invalid key) in webclient request");
+        }
+    } while (reader.consume(','));
+
+    return reader.consume(']');
+}
+
+}
+
+ExternalDownloadParser::ExternalDownloadParser(MegaApi *megaApi) : QObject()
+{
+    this->megaApi = megaApi;
+}
+
+bool ExternalDownloadParser::parse(MegaApi *megaApi, const QByteArray &json, QQueue<MegaNode *> &nodes)
+{
+    JSONReader reader(json);
+    QByteArray field, action, privateAuth, publicAuth, auth;
+    bool hasNodes = false;
+    bool ok = reader.consume('{') && !reader.consume('}');
+    while (ok)
+    {
+        ok = reader.readString(field) && reader.consume(':');
+        if (!ok)
+        {
+            break;
+        }
+
+        if (field == "a")
+        {
+            ok = reader.readString(action) && action == "d";
+        }
+        else if (field == "esid")
+        {
+            ok = reader.readString(privateAuth);
+        }
+        else if (field == "en")
+        {
+            ok = reader.readString(publicAuth);
+        }
+        else if (field == "auth")
+        {
+            ok = reader.readString(auth);
+        }
+        else if (field == "f" && !hasNodes)
+        {
+            // the credentials are sent before the list of nodes
+            if (privateAuth.isEmpty() && publicAuth.isEmpty())
+            {
+                if (auth.size() == 8)
+                {
+                    publicAuth = auth;
+                }
+                else
+                {
+                    privateAuth = auth;
+                }
+            }
+
+            hasNodes = true;
+            ok = (privateAuth.size() || publicAuth.size())
+                    && readNodes(megaApi, reader, privateAuth, publicAuth, nodes);
+        }
+        else
+        {
+            ok = reader.skipValue();
+        }
+
+        if (ok && !reader.consume(','))
+        {
+            ok = reader.consume('}') && reader.atEnd();
+            break;
+        }
+    }
+
+    if (!ok || !hasNodes || action != "d")
+    {
+        qDeleteAll(nodes);
+        nodes.clear();
+        return false;
+    }
+    return true;
+}
+
+void ExternalDownloadParser::parseRequest(int requestId, QByteArray json)
+{
+    long long startTime = QDateTime::currentMSecsSinceEpoch();
+    ExternalDownloadBatch batch;
+    batch.requestId = requestId;
+    parse(megaApi, json, batch.nodes);
+
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("External download request parsed: %1 nodes, %2 bytes, %3 ms")
+                 .arg(batch.nodes.size()).arg(json.size())
+                 .arg(QDateTime::currentMSecsSinceEpoch() - startTime).toUtf8().constData());
+    emit parsed(batch);
+}
@@ -0,0 +1,47 @@
+#ifndef EXTERNALDOWNLOADPARSER_H
+#define EXTERNALDOWNLOADPARSER_H
+
+#include <QObject>
+#include <QQueue>
+#include <QByteArray>
+#include <QMetaType>
+#include "megaapi.h"
+
+// Nodes of an external download request, empty if the request is invalid
+struct ExternalDownloadBatch
+{
+    int requestId;
+    QQueue<mega::MegaNode *> nodes;
+};
+Q_DECLARE_METATYPE(ExternalDownloadBatch)
+
+/*
+ * Decodes external download requests from the webclient ({"a":"d",...,"f":[...]}).
+ *
+ * The request is read in a single pass, without intermediate strings, and the
+ * foreign nodes are created as soon as each entry of "f" is complete. Big folders
+ * can have hundreds of thousands of entries, so requests are decoded in a worker
+ * thread and the result is sent back with parsed().
+ */
+class ExternalDownloadParser : public QObject
+{
+    Q_OBJECT
+
+public:
+    ExternalDownloadParser(mega::MegaApi *megaApi);
+
+    // The caller takes the ownership of the nodes. Returns false (and no nodes)
+    // if the request is invalid.
+    static bool parse(mega::MegaApi *megaApi, const QByteArray &json, QQueue<mega::MegaNode *> &nodes);
+
+signals:
+    void parsed(ExternalDownloadBatch batch);
+
+public slots:
+    void parseRequest(int requestId, QByteArray json);
+
+protected:
+    mega::MegaApi *megaApi;
+};
+
+#endif // EXTERNALDOWNLOADPARSER_H
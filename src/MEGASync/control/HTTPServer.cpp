@@ -5,6 +5,11 @@
 
 #include <iostream>
 
+// Limits of the requests accepted from the webclient
+#define MAX_HEADERS_SIZE (16 * 1024)
+#define MAX_BODY_SIZE (128 * 1024 * 1024)
+// Persistent connections without activity are closed after this time
+#define KEEPALIVE_TIMEOUT_MS 30000
 
 using namespace mega;
 
@@ -14,7 +19,30 @@ HTTPServer::HTTPServer(MegaApi *megaApi, quint16 port, bool sslEnabled)
     this->megaApi = megaApi;
     this->sslEnabled = sslEnabled;
     this->isFirstWebDownloadDone = false;
+    this->sslConfigurationLoaded = false;
+    connect(Preferences::instance(), SIGNAL(httpsCertificateChanged()), this, SLOT(onHttpsCertificateChanged()));
+
+    nextDownloadRequestId = 0;
+    qRegisterMetaType<ExternalDownloadBatch>("ExternalDownloadBatch");
+    parserThread = new QThread();
+    downloadParser = new ExternalDownloadParser(megaApi);
+    downloadParser->moveToThread(parserThread);
+    connect(this, SIGNAL(parseExternalDownload(int, QByteArray)), downloadParser, SLOT(parseRequest(int, QByteArray)), Qt::QueuedConnection);
+    connect(downloadParser, SIGNAL(parsed(ExternalDownloadBatch)), this, SLOT(onExternalDownloadParsed(ExternalDownloadBatch)), Qt::QueuedConnection);
+    parserThread->start();
     listen(QHostAddress::LocalHost, port);
+
+    idleTimer.setInterval(KEEPALIVE_TIMEOUT_MS / 2);
+    connect(&idleTimer, SIGNAL(timeout()), this, SLOT(closeIdleConnections()));
+    idleTimer.start();
+}
+
+HTTPServer::~HTTPServer()
+{
+    parserThread->quit();
+    parserThread->wait();
+    delete downloadParser;
+    delete parserThread;
 }
 
 #if QT_VERSION >= 0x050000
@@ -28,7 +56,6 @@ void HTTPServer::incomingConnection(int socket)
         return;
     }
 
-    Preferences *preferences = Preferences::instance();
     QTcpSocket* s = NULL;
     QSslSocket *sslSocket = NULL;
 
@@ -49,34 +76,67 @@ void HTTPServer::incomingConnection(int socket)
     connect(s, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(error(QAbstractSocket::SocketError)));
 
     s->setSocketDescriptor(socket);
-    requests.insert(s, new HTTPRequest());
+    HTTPConnection *connection = new HTTPConnection();
+    connection->lastActivity = QDateTime::currentMSecsSinceEpoch();
+    connections.insert(s, connection);
 
     if (sslSocket)
     {
-        sslSocket->setPeerVerifyMode(QSslSocket::VerifyNone);
-
-        QSslKey key(preferences->getHttpsKey().toUtf8(), QSsl::Rsa, QSsl::Pem, QSsl::PrivateKey);
-        if (key.isNull())
+        if (!loadSslConfiguration())
         {
             s->disconnectFromHost();
             return;
         }
 
+        sslSocket->setSslConfiguration(sslConfiguration);
+        sslSocket->startServerEncryption();
+    }
+}
+
+bool HTTPServer::loadSslConfiguration()
+{
+    if (sslConfigurationLoaded)
+    {
+        return true;
+    }
+
+    // the key and the certificates are decrypted and parsed only once,
+    // not for each connection of the webclient
+    Preferences *preferences = Preferences::instance();
+    QSslKey key(preferences->getHttpsKey().toUtf8(), QSsl::Rsa, QSsl::Pem, QSsl::PrivateKey);
+    if (key.isNull())
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Invalid key for the local HTTPS server");
+        return false;
+    }
+
+    QSslConfiguration configuration = QSslConfiguration::defaultConfiguration();
+    configuration.setPeerVerifyMode(QSslSocket::VerifyNone);
+    configuration.setPrivateKey(key);
+
 #if QT_VERSION >= 0x050100
-        QList<QSslCertificate> certificates;
-        certificates.append(QSslCertificate(preferences->getHttpsCert().toUtf8(), QSsl::Pem));
-        QStringList intermediates = preferences->getHttpsCertIntermediate().split(QString::fromUtf8(";"), QString::SkipEmptyParts);
-        for (int i = 0; i < intermediates.size(); i++)
-        {
-            certificates.append(QSslCertificate(intermediates.at(i).toUtf8(), QSsl::Pem));
-        }
-        sslSocket->setLocalCertificateChain(certificates);
+    QList<QSslCertificate> certificates;
+    certificates.append(QSslCertificate(preferences->getHttpsCert().toUtf8(), QSsl::Pem));
+    QStringList intermediates = preferences->getHttpsCertIntermediate().split(QString::fromUtf8(";"), QString::SkipEmptyParts);
+    for (int i = 0; i < intermediates.size(); i++)
+    {
+        certificates.append(QSslCertificate(intermediates.at(i).toUtf8(), QSsl::Pem));
+    }
+    configuration.setLocalCertificateChain(certificates);
 #else
-        sslSocket->setLocalCertificate(QSslCertificate(preferences->getHttpsCert().toUtf8(), QSsl::Pem));
+    configuration.setLocalCertificate(QSslCertificate(preferences->getHttpsCert().toUtf8(), QSsl::Pem));
 #endif
-        sslSocket->setPrivateKey(key);
-        sslSocket->startServerEncryption();
-    }
+
+    sslConfiguration = configuration;
+    sslConfigurationLoaded = true;
+    return true;
+}
+
+void HTTPServer::onHttpsCertificateChanged()
+{
+    // established connections keep their session, new ones use the new certificate
+    sslConfigurationLoaded = false;
+    sslConfiguration = QSslConfiguration();
 }
 
 void HTTPServer::pause()
@@ -92,121 +152,243 @@ void HTTPServer::resume()
 void HTTPServer::readClient()
 {
     QAbstractSocket *socket = (QSslSocket*)sender();
-    HTTPRequest *request = requests.value(socket);
-    if (disabled || !request)
+    HTTPConnection *connection = connections.value(socket);
+    if (disabled || !connection)
     {
         discardClient();
         return;
     }
 
-    request->data.append(QString::fromUtf8(socket->readAll().data()));
-    if (request->data.contains(QString::fromUtf8("\r\n\r\n")))
+    connection->buffer.append(socket->readAll());
+    connection->lastActivity = QDateTime::currentMSecsSinceEpoch();
+    if (connection->processing)
     {
-        QStringList tokens = request->data.split(QString::fromUtf8("\r\n\r\n"));
-        QStringList headers = tokens[0].split(QString::fromUtf8("\r\n"));
-        if (!headers.size() || !headers[0].startsWith(QString::fromAscii("POST")))
-        {
-            rejectRequest(socket, QString::fromUtf8("405 Method Not Allowed"));
-            return;
-        }
+        // the pending data is parsed when the current request finishes
+        return;
+    }
+
+    processBuffer(socket, connection);
+}
 
-        if (Preferences::HTTPS_ORIGIN_CHECK_ENABLED && !Preferences::HTTPS_ALLOWED_ORIGINS.isEmpty())
+void HTTPServer::processBuffer(QAbstractSocket *socket, HTTPConnection *connection)
+{
+    for (;;)
+    {
+        if (connection->state == HTTPConnection::STATE_HEADERS)
         {
-            bool found = false;
-            for (int i = 0; i < Preferences::HTTPS_ALLOWED_ORIGINS.size(); i++)
-            {                
-                QString check = QString::fromUtf8("Origin: %1").arg(Preferences::HTTPS_ALLOWED_ORIGINS.at(i));
-                for (int j = 0; j < headers.size(); j++)
+            int end = connection->buffer.indexOf("\r\n\r\n", connection->headerScanPos);
+            if (end < 0)
+            {
+                if (connection->buffer.size() > MAX_HEADERS_SIZE)
                 {
-                    if (!headers[j].compare(check, Qt::CaseInsensitive))
-                    {
-                       request->origin = i;
-                       found = true;
-                       break;
-                    }
+                    rejectRequest(socket, QString::fromUtf8("431 Request Header Fields Too Large"));
+                    return;
                 }
 
-                if (found)
-                {
-                    break;
-                }
+                // the separator could be split between two reads
+                connection->headerScanPos = qMax(0, connection->buffer.size() - 3);
+                return;
             }
 
-            if (!found)
+            QByteArray headers = connection->buffer.left(end);
+            connection->buffer.remove(0, end + 4);
+            connection->headerScanPos = 0;
+            if (!parseHeaders(socket, connection, headers))
             {
-                rejectRequest(socket);
                 return;
             }
+            connection->state = HTTPConnection::STATE_BODY;
         }
 
-        QString contentLengthId = QString::fromUtf8("Content-length: ");
-        QStringList contentLengthHeader = headers.filter(QRegExp(contentLengthId, Qt::CaseInsensitive));
-        if (!contentLengthHeader.size())
+        if (connection->buffer.size() < connection->request.contentLength)
         {
-            rejectRequest(socket);
             return;
         }
 
-        bool ok;
-        request->contentLength = contentLengthHeader[0].mid(contentLengthId.size(), contentLengthHeader[0].size() - contentLengthId.size()).toInt(&ok);
-        if (!ok || request->contentLength < tokens[1].size())
+        HTTPRequest request = connection->request;
+        request.body = connection->buffer.left(request.contentLength);
+        connection->buffer.remove(0, request.contentLength);
+        connection->request = HTTPRequest();
+        connection->state = HTTPConnection::STATE_HEADERS;
+
+        // processing the request can run the event loop
+        connection->processing = true;
+        bool finished = processRequest(socket, request);
+        if (connections.value(socket) != connection || !finished)
         {
-            rejectRequest(socket);
             return;
         }
+        connection->processing = false;
 
-        if (request->contentLength > tokens[1].size())
+        if (!request.keepAlive)
         {
             return;
         }
+    }
+}
 
-        request->data = tokens[1];
-        processRequest(socket, *request);
+bool HTTPServer::parseHeaders(QAbstractSocket *socket, HTTPConnection *connection, const QByteArray &headers)
+{
+    HTTPRequest &request = connection->request;
+    QList<QByteArray> lines = headers.split('\n');
+    QList<QByteArray> requestLine = lines.at(0).trimmed().split(' ');
+    if (requestLine.size() != 3 || requestLine.at(0) != "POST")
+    {
+        rejectRequest(socket, QString::fromUtf8("405 Method Not Allowed"));
+        return false;
+    }
 
-        HTTPRequest *req = requests.value(socket, NULL);
-        if (request == req)
+    // HTTP/1.1 connections are persistent unless the client says otherwise
+    request.keepAlive = (requestLine.at(2) == "HTTP/1.1");
+    bool hasContentLength = false;
+    bool originCheck = Preferences::HTTPS_ORIGIN_CHECK_ENABLED && !Preferences::HTTPS_ALLOWED_ORIGINS.isEmpty();
+    for (int i = 1; i < lines.size(); i++)
+    {
+        const QByteArray &line = lines.at(i);
+        int separator = line.indexOf(':');
+        if (separator <= 0)
+        {
+            continue;
+        }
+
+        QByteArray name = line.left(separator).trimmed().toLower();
+        QByteArray value = line.mid(separator + 1).trimmed();
+        if (name == "content-length")
+        {
+            bool ok;
+            request.contentLength = value.toInt(&ok);
+            if (!ok || request.contentLength < 0)
+            {
+                rejectRequest(socket);
+                return false;
+            }
+            hasContentLength = true;
+        }
+        else if (name == "connection")
+        {
+            QByteArray option = value.toLower();
+            if (option == "close")
+            {
+                request.keepAlive = false;
+            }
+            else if (option == "keep-alive")
+            {
+                request.keepAlive = true;
+            }
+        }
+        else if (name == "origin" && originCheck && request.origin < 0)
         {
-            requests.remove(socket);
-            delete request;
+            QString origin = QString::fromUtf8(value.constData(), value.size());
+            for (int j = 0; j < Preferences::HTTPS_ALLOWED_ORIGINS.size(); j++)
+            {
+                if (!origin.compare(Preferences::HTTPS_ALLOWED_ORIGINS.at(j), Qt::CaseInsensitive))
+                {
+                    request.origin = j;
+                    break;
+                }
+            }
+        }
+        else if (name == "transfer-encoding")
+        {
+            // the webclient always sends the size of the body
+            rejectRequest(socket, QString::fromUtf8("411 Length Required"));
+            return false;
         }
     }
+
+    if (originCheck && request.origin < 0)
+    {
+        rejectRequest(socket);
+        return false;
+    }
+
+    if (!hasContentLength)
+    {
+        rejectRequest(socket);
+        return false;
+    }
+
+    if (request.contentLength > MAX_BODY_SIZE)
+    {
+        rejectRequest(socket, QString::fromUtf8("413 Request Entity Too Large"));
+        return false;
+    }
+    return true;
+}
+
+void HTTPServer::closeIdleConnections()
+{
+    long long now = QDateTime::currentMSecsSinceEpoch();
+    QList<QAbstractSocket *> idle;
+    for (QMap<QAbstractSocket*, HTTPConnection*>::const_iterator it = connections.constBegin(); it != connections.constEnd(); ++it)
+    {
+        HTTPConnection *connection = it.value();
+        if (!connection->processing && (now - connection->lastActivity) > KEEPALIVE_TIMEOUT_MS)
+        {
+            idle.append(it.key());
+        }
+    }
+
+    for (int i = 0; i < idle.size(); i++)
+    {
+        QAbstractSocket *socket = idle.at(i);
+        removeConnection(socket);
+        socket->disconnectFromHost();
+        socket->deleteLater();
+    }
 }
+
 void HTTPServer::discardClient()
 {
     QAbstractSocket* socket = (QSslSocket*)sender();
     socket->deleteLater();
+    removeConnection(socket);
+}
 
-    HTTPRequest *request = requests.value(socket);
-    if (request)
+void HTTPServer::removeConnection(QAbstractSocket *socket)
+{
+    HTTPConnection *connection = connections.value(socket);
+    if (connection)
     {
-        requests.remove(socket);
-        delete request;
+        connections.remove(socket);
+        delete connection;
     }
 }
 
 void HTTPServer::rejectRequest(QAbstractSocket *socket, QString response)
 {
-    socket->write(QString::fromUtf8("HTTP/1.0 %1\r\n"
+    socket->write(QString::fromUtf8("HTTP/1.1 %1\r\n"
+                  "Content-Length: 0\r\n"
+                  "Connection: close\r\n"
                   "\r\n").arg(response).toUtf8());
     socket->flush();
     socket->disconnectFromHost();
     socket->deleteLater();
-
-    HTTPRequest *request = requests.value(socket);
-    if (request)
-    {
-        requests.remove(socket);
-        delete request;
-    }
+    removeConnection(socket);
 }
 
-void HTTPServer::processRequest(QAbstractSocket *socket, HTTPRequest request)
+bool HTTPServer::processRequest(QAbstractSocket *socket, HTTPRequest request)
 {
     QString response;
     QString openLinkRequestStart(QString::fromUtf8("{\"a\":\"l\","));
-    QString externalDownloadRequestStart = QString::fromUtf8("{\"a\":\"d\",");
     QPointer<QAbstractSocket> safeSocket = socket;
 
+    // the body of external downloads can be huge, it goes to the parser as is
+    if (request.body.startsWith("{\"a\":\"d\","))
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "ExternalDownload command received from the webclient");
+
+        // the response is sent when the parser finishes
+        PendingDownloadRequest pending;
+        pending.socket = socket;
+        pending.request = request;
+        int requestId = nextDownloadRequestId++;
+        pendingDownloadRequests.insert(requestId, pending);
+        emit parseExternalDownload(requestId, request.body);
+        return false;
+    }
+
+    request.data = QString::fromUtf8(request.body.constData(), request.body.size());
     if (request.data == QString::fromUtf8("{\"a\":\"v\"}"))
     {
         MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "GetVersion command received from the webclient");
@@ -260,154 +442,77 @@ void HTTPServer::processRequest(QAbstractSocket *socket, HTTPRequest request)
             response = QString::fromUtf8("-14");
         }
     }
-    else if (request.data.startsWith(externalDownloadRequestStart))
+    if (!response.size())
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "ExternalDownload command received from the webclient");
-        int start = request.data.indexOf(QString::fromUtf8("\"f\":[")) + 5;
-        if (start > 0)
-        {
-            QString privateAuth = Utilities::extractJSONString(request.data.mid(0, start), QString::fromUtf8("esid"));
-            QString publicAuth = Utilities::extractJSONString(request.data.mid(0, start), QString::fromUtf8("en"));
-
-            if (privateAuth.isEmpty() && publicAuth.isEmpty())
-            {
-                QString auth  = Utilities::extractJSONString(request.data.mid(0, start), QString::fromUtf8("auth"));
-                if (auth.length() == 8)
-                {
-                    publicAuth = auth;
-                }
-                else
-                {
-                    privateAuth = auth;
-                }
-            }
+        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, QString::fromUtf8("Invalid webclient request: %1").arg(request.data).toUtf8().constData());
+        response = QString::fromUtf8("-2");
+    }
 
-            if (privateAuth.size() || publicAuth.size())
-            {
-                QQueue<mega::MegaNode *> downloadQueue;
-                int end;
-                bool firstnode = true;
+    if (safeSocket)
+    {
+        sendResponse(safeSocket, request, response);
+    }
+    return true;
+}
 
-                while (request.data[start] == QChar::fromAscii('{'))
-                {
-                    end = request.data.indexOf(QChar::fromAscii('}'), start);
-                    if (end < 0)
-                    {
-                        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Error parsing webclient request");
-                        qDeleteAll(downloadQueue);
-                        downloadQueue.clear();
-                        break;
-                    }
-
-                    end++;
-                    QString file = request.data.mid(start, end - start);
-                    start = end + 1;
-
-                    int type = Utilities::extractJSONNumber(file, QString::fromUtf8("t"));
-                    if (type < 0)
-                    {
-                        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without type in webclient request");
-                        qDeleteAll(downloadQueue);
-                        downloadQueue.clear();
-                        break;
-                    }
-
-                    QString handle = Utilities::extractJSONString(file, QString::fromUtf8("h"));
-                    if (handle.isEmpty())
-                    {
-                        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without handle in webclient request");
-                        qDeleteAll(downloadQueue);
-                        downloadQueue.clear();
-                        break;
-                    }
-
-                    QString name = Utilities::extractJSONString(file, QString::fromUtf8("n"));
-                    name.replace(QString::fromUtf8("-"), QString::fromUtf8("+"));
-                    name.replace(QString::fromUtf8("_"), QString::fromUtf8("/"));
-                    name = QString::fromUtf8(QByteArray::fromBase64(name.toUtf8().constData()).constData());
-                    if (name.isEmpty())
-                    {
-                        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without name in webclient request");
-                        qDeleteAll(downloadQueue);
-                        downloadQueue.clear();
-                        break;
-                    }
-
-                    MegaHandle h = megaApi->base64ToHandle(handle.toUtf8().constData());
-                    MegaHandle p = INVALID_HANDLE;
-
-                    if (!firstnode)
-                    {
-                        QString parentHandle = Utilities::extractJSONString(file, QString::fromUtf8("p"));
-                        p = megaApi->base64ToHandle(parentHandle.toUtf8().constData());
-                        QApplication::processEvents();
-                    }
-                    else
-                    {
-                        firstnode = false;
-                    }
-
-                    if (type != MegaNode::TYPE_FILE)
-                    {
-                        MegaNode *node = megaApi->createForeignFolderNode(h, name.toUtf8().constData(), p,
-                                                                         privateAuth.toUtf8().constData(),
-                                                                         publicAuth.toUtf8().constData());
-                        downloadQueue.append(node);
-                    }
-                    else
-                    {
-                        QString key = Utilities::extractJSONString(file, QString::fromUtf8("k"));
-                        if (key.size() == 43)
-                        {
-                            long long size = Utilities::extractJSONNumber(file, QString::fromUtf8("s"));
-                            long long mtime = Utilities::extractJSONNumber(file, QString::fromUtf8("ts"));
-
-                            MegaNode *node = megaApi->createForeignFileNode(h, key.toUtf8().constData(),
-                                                             name.toUtf8().constData(), size, mtime,
-                                                             p, privateAuth.toUtf8().constData(),
-                                                             publicAuth.toUtf8().constData());
-                            downloadQueue.append(node);
-                        }
-                        else
-                        {
-                            MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without key (or an invalid key) in webclient request");
-                        }
-                    }
-                }
+void HTTPServer::onExternalDownloadParsed(ExternalDownloadBatch batch)
+{
+    PendingDownloadRequest pending = pendingDownloadRequests.take(batch.requestId);
+    QString response;
+    if (batch.nodes.size())
+    {
+        emit onExternalDownloadRequested(batch.nodes);
+        emit onExternalDownloadRequestFinished();
+        response = QString::fromUtf8("0");
+    }
+    else
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, QByteArray("Invalid webclient request: ").append(pending.request.body).constData());
+        response = QString::fromUtf8("-2");
+    }
 
-                if (downloadQueue.size())
-                {
-                    emit onExternalDownloadRequested(downloadQueue);
-                    emit onExternalDownloadRequestFinished();
-                    response = QString::fromUtf8("0");
-                }
-            }
-        }
+    QAbstractSocket *socket = pending.socket;
+    HTTPConnection *connection = socket ? connections.value(socket) : NULL;
+    if (!connection)
+    {
+        return;
     }
 
-    if (!response.size())
+    sendResponse(socket, pending.request, response);
+    if (connections.value(socket) != connection)
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, QString::fromUtf8("Invalid webclient request: %1").arg(request.data).toUtf8().constData());
-        response = QString::fromUtf8("-2");
+        return;
     }
 
-    QString fullResponse = QString::fromUtf8("HTTP/1.0 200 Ok\r\n"
-                                             "Access-Control-Allow-Origin: %1\r\n"
-                                             "Content-Type: text/html; charset=\"utf-8\"\r\n"
-                                             "Content-Length: %2\r\n"
-                                             "\r\n"
-                                             "%3")
+    // continue with the requests received in the meantime
+    connection->processing = false;
+    connection->lastActivity = QDateTime::currentMSecsSinceEpoch();
+    processBuffer(socket, connection);
+}
+
+void HTTPServer::sendResponse(QAbstractSocket *socket, const HTTPRequest &request, QString response)
+{
+    QByteArray body = response.toUtf8();
+    QByteArray fullResponse = QString::fromUtf8("HTTP/1.1 200 OK\r\n"
+                                                "Access-Control-Allow-Origin: %1\r\n"
+                                                "Content-Type: text/html; charset=\"utf-8\"\r\n"
+                                                "Content-Length: %2\r\n"
+                                                "Connection: %3\r\n"
+                                                "\r\n")
             .arg((request.origin < 0 || request.origin >= Preferences::HTTPS_ALLOWED_ORIGINS.size())
                  ? QString::fromUtf8("*") : Preferences::HTTPS_ALLOWED_ORIGINS.at(request.origin))
-            .arg(response.size())
-            .arg(response);
+            .arg(body.size())
+            .arg(request.keepAlive ? QString::fromUtf8("keep-alive") : QString::fromUtf8("close"))
+            .toUtf8();
+    fullResponse.append(body);
 
-    if (safeSocket)
+    socket->write(fullResponse);
+    socket->flush();
+    if (!request.keepAlive)
     {
-        safeSocket->write(fullResponse.toUtf8());
-        safeSocket->flush();
-        safeSocket->disconnectFromHost();
-        safeSocket->deleteLater();
+        socket->disconnectFromHost();
+        socket->deleteLater();
+        removeConnection(socket);
     }
 }
 
@@ -4,20 +4,49 @@
 #include <QTcpServer>
 #include <QSslSocket>
 #include <QSslKey>
+#include <QSslConfiguration>
 #include <QFile>
 #include <QStringList>
 #include <QDateTime>
 #include <QQueue>
+#include <QHash>
+#include <QTimer>
+#include <QThread>
+#include <QPointer>
 
 #include <megaapi.h>
+#include "ExternalDownloadParser.h"
 
 class HTTPRequest
 {
 public:
-    HTTPRequest() : contentLength(0), origin(-1) {}
+    HTTPRequest() : contentLength(0), origin(-1), keepAlive(false) {}
+    // raw body, external downloads are parsed without decoding it
+    QByteArray body;
+    // decoded body of the rest of the requests
     QString data;
     int contentLength;
     int origin;
+    bool keepAlive;
+};
+
+// Parser state of a connection, requests can be pipelined
+class HTTPConnection
+{
+public:
+    enum {
+        STATE_HEADERS = 0,
+        STATE_BODY
+    };
+
+    HTTPConnection() : state(STATE_HEADERS), headerScanPos(0), processing(false), lastActivity(0) {}
+    QByteArray buffer;
+    int state;
+    // position where the search of the end of the headers continues
+    int headerScanPos;
+    bool processing;
+    long long lastActivity;
+    HTTPRequest request;
 };
 
 class HTTPServer: public QTcpServer
@@ -26,6 +55,7 @@ class HTTPServer: public QTcpServer
 
     public:
         HTTPServer(mega::MegaApi *megaApi, quint16 port, bool sslEnabled);
+        virtual ~HTTPServer();
 #if QT_VERSION >= 0x050000
         void incomingConnection(qintptr socket);
 #else
@@ -35,6 +65,7 @@ class HTTPServer: public QTcpServer
         void resume();
 
     signals:
+        void parseExternalDownload(int requestId, QByteArray json);
         void onLinkReceived(QString link, QString auth);
         void onSyncRequested(long long handle);
         void onExternalDownloadRequested(QQueue<mega::MegaNode*> files);
@@ -42,19 +73,45 @@ class HTTPServer: public QTcpServer
 
     private slots:
         void readClient();
+        void closeIdleConnections();
         void discardClient();
         void rejectRequest(QAbstractSocket *socket, QString response = QString::fromUtf8("403 Forbidden"));
-        void processRequest(QAbstractSocket *socket, HTTPRequest request);
+        void onExternalDownloadParsed(ExternalDownloadBatch batch);
         void error(QAbstractSocket::SocketError);
         void sslErrors(const QList<QSslError> & errors);
         void peerVerifyError(const QSslError & error);
+        void onHttpsCertificateChanged();
 
     private:
+        // processes the complete requests in the buffer of the connection
+        void processBuffer(QAbstractSocket *socket, HTTPConnection *connection);
+        // returns false if the response will be sent later
+        bool processRequest(QAbstractSocket *socket, HTTPRequest request);
+        // returns false if the request was rejected
+        bool parseHeaders(QAbstractSocket *socket, HTTPConnection *connection, const QByteArray &headers);
+        void sendResponse(QAbstractSocket *socket, const HTTPRequest &request, QString response);
+        void removeConnection(QAbstractSocket *socket);
+        // builds the TLS configuration from the preferences if it isn't cached
+        bool loadSslConfiguration();
+
         bool disabled;
         bool sslEnabled;
         bool isFirstWebDownloadDone;
         mega::MegaApi *megaApi;
-        QMap<QAbstractSocket*, HTTPRequest*> requests;
+        QMap<QAbstractSocket*, HTTPConnection*> connections;
+        QTimer idleTimer;
+        QSslConfiguration sslConfiguration;
+        bool sslConfigurationLoaded;
+
+        struct PendingDownloadRequest
+        {
+            QPointer<QAbstractSocket> socket;
+            HTTPRequest request;
+        };
+        QThread *parserThread;
+        ExternalDownloadParser *downloadParser;
+        QHash<int, PendingDownloadRequest> pendingDownloadRequests;
+        int nextDownloadRequestId;
 };
 
 #endif // HTTPSERVER_H
@@ -0,0 +1,166 @@
+#include "LocalCacheChecker.h"
+#include "megaapi.h"
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFile>
+#include <QDateTime>
+#include <string.h>
+
+#ifdef USE_SQLITE
+#include <sqlite3.h>
+#endif
+
+// Table used by the SDK to store the state of the account
+#define CACHE_TABLE "statecache"
+#define CORRUPT_SUFFIX ".corrupt"
+
+using namespace mega;
+
+int LocalCacheChecker::checkCaches(QString dataPath)
+{
+#ifdef USE_SQLITE
+    long long startTime = QDateTime::currentMSecsSinceEpoch();
+    int quarantined = 0;
+
+    QStringList caches;
+    QDirIterator di(dataPath, QDir::Files | QDir::NoDotAndDotDot);
+    while (di.hasNext())
+    {
+        di.next();
+        if (di.fileName().endsWith(QString::fromAscii(".db")))
+        {
+            caches.append(di.filePath());
+        }
+    }
+
+    for (int i = 0; i < caches.size(); i++)
+    {
+        if (!isValidCache(caches.at(i)))
+        {
+            MegaApi::log(MegaApi::LOG_LEVEL_WARNING, QString::fromUtf8("Corrupt local cache: %1")
+                         .arg(QFileInfo(caches.at(i)).fileName()).toUtf8().constData());
+            quarantine(caches.at(i));
+            quarantined++;
+        }
+    }
+
+    // leftovers of caches that don't exist anymore
+    QDirIterator orphans(dataPath, QDir::Files | QDir::NoDotAndDotDot);
+    while (orphans.hasNext())
+    {
+        orphans.next();
+        QString fileName = orphans.fileName();
+        if (isCacheFile(fileName) && !fileName.endsWith(QString::fromAscii(".db"))
+                && !QFile::exists(orphans.filePath().left(orphans.filePath().lastIndexOf(QChar::fromAscii('-')))))
+        {
+            QFile::remove(orphans.filePath());
+        }
+    }
+
+    MegaApi::log(MegaApi::LOG_LEVEL_INFO, QString::fromUtf8("Local caches checked: %1 valid, %2 corrupt, %3 ms")
+                 .arg(caches.size() - quarantined).arg(quarantined)
+                 .arg(QDateTime::currentMSecsSinceEpoch() - startTime).toUtf8().constData());
+    return quarantined;
+#else
+    // the caches can't be checked without SQLite, discard them
+    removeCaches(dataPath);
+    return 0;
+#endif
+}
+
+void LocalCacheChecker::removeCaches(QString dataPath)
+{
+    QDirIterator di(dataPath, QDir::Files | QDir::NoDotAndDotDot);
+    while (di.hasNext())
+    {
+        di.next();
+        if (isCacheFile(di.fileName()))
+        {
+            QFile::remove(di.filePath());
+        }
+    }
+}
+
+bool LocalCacheChecker::isValidCache(QString path)
+{
+#ifdef USE_SQLITE
+    sqlite3 *db = NULL;
+    // opened in read-write mode so that a pending WAL is recovered
+    if (sqlite3_open_v2(QFile::encodeName(path).constData(), &db, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK)
+    {
+        sqlite3_close(db);
+        return false;
+    }
+
+    sqlite3_stmt *stmt = NULL;
+
+    // the SDK encodes the version of its schema in the file name,
+    // so only the layout of the table is verified here
+    int columns = 0;
+    if (sqlite3_prepare_v2(db, "PRAGMA table_info(" CACHE_TABLE ")", -1, &stmt, NULL) == SQLITE_OK)
+    {
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const char *name = (const char *)sqlite3_column_text(stmt, 1);
+            if (name && (!strcmp(name, "id") || !strcmp(name, "content")))
+            {
+                columns++;
+            }
+        }
+    }
+    sqlite3_finalize(stmt);
+    stmt = NULL;
+    bool valid = (columns == 2);
+
+    // quick_check verifies the structure of the file without checking the indexes,
+    // which is enough to detect torn or truncated pages
+    if (valid)
+    {
+        valid = false;
+        if (sqlite3_prepare_v2(db, "PRAGMA quick_check", -1, &stmt, NULL) == SQLITE_OK
+                && sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const char *result = (const char *)sqlite3_column_text(stmt, 0);
+            valid = result && !strcmp(result, "ok");
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    sqlite3_close(db);
+    return valid;
+#else
+    Q_UNUSED(path);
+    return false;
+#endif
+}
+
+bool LocalCacheChecker::isCacheFile(QString fileName)
+{
+    return fileName.endsWith(QString::fromAscii(".db"))
+            || fileName.endsWith(QString::fromAscii(".db-wal"))
+            || fileName.endsWith(QString::fromAscii(".db-shm"));
+}
+
+void LocalCacheChecker::quarantine(QString path)
+{
+    QStringList files;
+    files.append(path);
+    files.append(path + QString::fromAscii("-wal"));
+    files.append(path + QString::fromAscii("-shm"));
+    for (int i = 0; i < files.size(); i++)
+    {
+        QString file = files.at(i);
+        if (!QFile::exists(file))
+        {
+            continue;
+        }
+
+        // only the last corrupt copy is kept, for diagnosis
+        QString target = file + QString::fromAscii(CORRUPT_SUFFIX);
+        QFile::remove(target);
+        if (!QFile::rename(file, target))
+        {
+            QFile::remove(file);
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef LOCALCACHECHECKER_H
+#define LOCALCACHECHECKER_H
+
+#include <QString>
+
+/*
+ * Integrity check of the SQLite caches (*.db) of the SDK after an unclean exit.
+ *
+ * Caches that pass the check are kept, so the next login doesn't need a full fetchnodes.
+ * Corrupt ones are moved aside (with their -wal and -shm files) with a ".corrupt" suffix.
+ */
+class LocalCacheChecker
+{
+public:
+    // Returns the number of caches that were quarantined
+    static int checkCaches(QString dataPath);
+    static void removeCaches(QString dataPath);
+
+    static bool isValidCache(QString path);
+
+private:
+    LocalCacheChecker() {}
+    static bool isCacheFile(QString fileName);
+    static void quarantine(QString path);
+};
+
+#endif // LOCALCACHECHECKER_H
@@ -0,0 +1,359 @@
+#include "LocalCopier.h"
+#include "Preferences.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFile>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#endif
+
+#define PROGRESS_INTERVAL_MS 500
+// Size of each read/write or copy_file_range call
+#define COPY_CHUNK_SIZE (8 * 1024 * 1024)
+#define READ_BUFFER_SIZE (1024 * 1024)
+
+LocalCopier::LocalCopier(QObject *parent) :
+    QObject(parent),
+    activeTasks(0),
+    currentGeneration(0)
+{
+    batchGeneration = 0;
+    batchCancelled = false;
+    copiedBytes = 0;
+    totalBytes = 0;
+    pool.setMaxThreadCount(Preferences::MAX_LOCAL_COPY_THREADS);
+
+    progressTimer.setInterval(PROGRESS_INTERVAL_MS);
+    connect(&progressTimer, SIGNAL(timeout()), this, SLOT(reportProgress()));
+}
+
+LocalCopier::~LocalCopier()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+void LocalCopier::copy(QString srcPath, QString dstPath)
+{
+    if (!srcPath.size() || !dstPath.size() || srcPath == dstPath)
+    {
+        return;
+    }
+
+    QFileInfo source(srcPath);
+    if (!source.exists() || QFileInfo(dstPath).exists())
+    {
+        return;
+    }
+
+    int current = currentGeneration.fetchAndAddAcquire(0);
+    if (!progressTimer.isActive())
+    {
+        batchGeneration = current;
+        batchCancelled = false;
+        progressTimer.start();
+    }
+    else if (batchGeneration != current)
+    {
+        // the batch was cancelled but the cancelled tasks haven't finished yet,
+        // the new copies are added to it and aren't affected by that cancellation
+        batchGeneration = current;
+        batchCancelled = true;
+    }
+    startTask(srcPath, dstPath, source.isDir(), current);
+}
+
+void LocalCopier::cancel()
+{
+    currentGeneration.fetchAndAddOrdered(1);
+}
+
+bool LocalCopier::isActive()
+{
+    return activeTasks.fetchAndAddAcquire(0) != 0;
+}
+
+void LocalCopier::reportProgress()
+{
+    bytesMutex.lock();
+    long long copied = copiedBytes;
+    long long total = totalBytes;
+    bytesMutex.unlock();
+    emit progress(copied, total);
+
+    if (isActive())
+    {
+        return;
+    }
+
+    progressTimer.stop();
+    bytesMutex.lock();
+    copiedBytes = 0;
+    totalBytes = 0;
+    bytesMutex.unlock();
+    emit finished(batchCancelled || isCancelled(batchGeneration));
+}
+
+LocalCopier::CopyTask::CopyTask(LocalCopier *copier, QString srcPath, QString dstPath, bool isFolder, int generation)
+{
+    this->copier = copier;
+    this->srcPath = srcPath;
+    this->dstPath = dstPath;
+    this->isFolder = isFolder;
+    this->generation = generation;
+    setAutoDelete(true);
+}
+
+void LocalCopier::CopyTask::run()
+{
+    if (!copier->isCancelled(generation))
+    {
+        if (isFolder)
+        {
+            copier->copyFolder(srcPath, dstPath, generation);
+        }
+        else
+        {
+            copyFile(srcPath, dstPath, copier, generation);
+        }
+    }
+    copier->activeTasks.fetchAndAddOrdered(-1);
+}
+
+void LocalCopier::startTask(QString srcPath, QString dstPath, bool isFolder, int generation)
+{
+    if (!isFolder)
+    {
+        bytesMutex.lock();
+        totalBytes += QFileInfo(srcPath).size();
+        bytesMutex.unlock();
+    }
+
+    activeTasks.fetchAndAddOrdered(1);
+    pool.start(new CopyTask(this, srcPath, dstPath, isFolder, generation));
+}
+
+// Creates the folder and starts a task for each entry
+void LocalCopier::copyFolder(QString srcPath, QString dstPath, int generation)
+{
+    QDir dstDir(dstPath);
+    if (dstDir.exists() || !dstDir.mkpath(QString::fromAscii(".")))
+    {
+        return;
+    }
+
+#ifndef WIN32
+    struct stat st;
+    if (!stat(srcPath.toUtf8().constData(), &st))
+    {
+        chmod(dstPath.toUtf8().constData(), st.st_mode & 07777);
+    }
+#endif
+
+    QDirIterator di(srcPath, QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot);
+    while (di.hasNext() && !isCancelled(generation))
+    {
+        di.next();
+        QFileInfo info = di.fileInfo();
+        if (info.isSymLink())
+        {
+            continue;
+        }
+
+        QString entryDstPath = dstPath + QDir::separator() + di.fileName();
+        if (info.isDir())
+        {
+            startTask(di.filePath(), entryDstPath, true, generation);
+        }
+        else if (info.isFile())
+        {
+            startTask(di.filePath(), entryDstPath, false, generation);
+        }
+    }
+}
+
+void LocalCopier::addCopiedBytes(long long bytes)
+{
+    bytesMutex.lock();
+    copiedBytes += bytes;
+    bytesMutex.unlock();
+}
+
+bool LocalCopier::isCancelled(int generation)
+{
+    return currentGeneration.fetchAndAddAcquire(0) != generation;
+}
+
+bool LocalCopier::copyFile(QString srcPath, QString dstPath, LocalCopier *copier, int generation)
+{
+#ifdef WIN32
+    // CopyFile already keeps the attributes and the modification time
+    bool result = QFile::copy(srcPath, dstPath);
+    if (result && copier)
+    {
+        copier->addCopiedBytes(QFileInfo(srcPath).size());
+    }
+    return result;
+#else
+    int in = open(srcPath.toUtf8().constData(), O_RDONLY);
+    if (in < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(in, &st) || !S_ISREG(st.st_mode))
+    {
+        close(in);
+        return false;
+    }
+
+    // never overwrite, the destination could have been created in the meantime
+    QByteArray dst = dstPath.toUtf8();
+    int out = open(dst.constData(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (out < 0)
+    {
+        close(in);
+        return false;
+    }
+
+    bool result = false;
+    long long copied = 0;
+
+#ifdef FICLONE
+    if (!ioctl(out, FICLONE, in))
+    {
+        copied = st.st_size;
+        result = true;
+        if (copier)
+        {
+            copier->addCopiedBytes(copied);
+        }
+    }
+#endif
+
+#ifdef SYS_copy_file_range
+    while (!result && copied < st.st_size)
+    {
+        if (copier && copier->isCancelled(generation))
+        {
+            break;
+        }
+
+        long long chunk = qMin((long long)COPY_CHUNK_SIZE, (long long)st.st_size - copied);
+        ssize_t written = syscall(SYS_copy_file_range, in, NULL, out, NULL, (size_t)chunk, 0);
+        if (written <= 0)
+        {
+            // not supported by the kernel or between these filesystems,
+            // continue with read/write from the same offset
+            break;
+        }
+
+        copied += written;
+        if (copier)
+        {
+            copier->addCopiedBytes(written);
+        }
+    }
+    if (!result && copied == st.st_size)
+    {
+        result = true;
+    }
+#endif
+
+    if (!result && lseek(in, copied, SEEK_SET) == copied && lseek(out, copied, SEEK_SET) == copied)
+    {
+        char *buffer = new char[READ_BUFFER_SIZE];
+        for (;;)
+        {
+            if (copier && copier->isCancelled(generation))
+            {
+                break;
+            }
+
+            ssize_t numRead = read(in, buffer, READ_BUFFER_SIZE);
+            if (numRead < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (numRead <= 0)
+            {
+                result = !numRead;
+                break;
+            }
+
+            ssize_t pos = 0;
+            while (pos < numRead)
+            {
+                ssize_t numWritten = write(out, buffer + pos, numRead - pos);
+                if (numWritten < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (numWritten <= 0)
+                {
+                    break;
+                }
+                pos += numWritten;
+            }
+
+            if (pos < numRead)
+            {
+                break;
+            }
+
+            if (copier)
+            {
+                copier->addCopiedBytes(numRead);
+            }
+        }
+        delete [] buffer;
+    }
+
+    if (result)
+    {
+        fchmod(out, st.st_mode & 07777);
+#ifdef __APPLE__
+        struct timeval times[2];
+        times[0].tv_sec = st.st_atimespec.tv_sec;
+        times[0].tv_usec = st.st_atimespec.tv_nsec / 1000;
+        times[1].tv_sec = st.st_mtimespec.tv_sec;
+        times[1].tv_usec = st.st_mtimespec.tv_nsec / 1000;
+        futimes(out, times);
+#else
+        struct timespec times[2];
+        times[0] = st.st_atim;
+        times[1] = st.st_mtim;
+        futimens(out, times);
+#endif
+    }
+
+    close(in);
+    if (close(out))
+    {
+        result = false;
+    }
+
+    if (!result)
+    {
+        unlink(dst.constData());
+    }
+    return result;
+#endif
+}
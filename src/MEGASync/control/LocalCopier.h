@@ -0,0 +1,76 @@
+#ifndef LOCALCOPIER_H
+#define LOCALCOPIER_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QTimer>
+
+/*
+ * Copies files and folders to local (synced) folders using a bounded pool of threads.
+ *
+ * Each file is copied in a single pass: the data is cloned (FICLONE) or copied in
+ * the kernel (copy_file_range) when the filesystem allows it, and the permissions
+ * and modification time are set on the open destination file.
+ * Existing destinations are never overwritten.
+ */
+class LocalCopier : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LocalCopier(QObject *parent = 0);
+    ~LocalCopier();
+
+    void copy(QString srcPath, QString dstPath);
+    void cancel();
+    bool isActive();
+
+    // If copier isn't NULL it's used to report the progress and to check
+    // the cancellation of the tasks started in the generation passed
+    static bool copyFile(QString srcPath, QString dstPath, LocalCopier *copier = NULL, int generation = 0);
+
+signals:
+    void progress(long long copiedBytes, long long totalBytes);
+    void finished(bool cancelled);
+
+protected slots:
+    void reportProgress();
+
+protected:
+    class CopyTask : public QRunnable
+    {
+    public:
+        CopyTask(LocalCopier *copier, QString srcPath, QString dstPath, bool isFolder, int generation);
+        void run();
+
+    protected:
+        LocalCopier *copier;
+        QString srcPath;
+        QString dstPath;
+        bool isFolder;
+        int generation;
+    };
+
+    void startTask(QString srcPath, QString dstPath, bool isFolder, int generation);
+    void copyFolder(QString srcPath, QString dstPath, int generation);
+    void addCopiedBytes(long long bytes);
+    bool isCancelled(int generation);
+
+    QThreadPool pool;
+    QAtomicInt activeTasks;
+    // Incremented by cancel(), tasks started before that are cancelled
+    QAtomicInt currentGeneration;
+    // Generation of the first task reported by the current batch
+    int batchGeneration;
+    bool batchCancelled;
+    QMutex bytesMutex;
+    long long copiedBytes;
+    long long totalBytes;
+    QTimer progressTimer;
+};
+
+#endif // LOCALCOPIER_H
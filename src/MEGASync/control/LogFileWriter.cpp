@@ -0,0 +1,307 @@
+#include "LogFileWriter.h"
+#include <climits>
+#include <string.h>
+#include <zlib.h>
+
+// The file is closed after this time without new lines so it can be moved or deleted
+#define IDLE_CLOSE_MS 2000
+// Size of the chunks read and compressed when a rotated file is compressed
+#define COMPRESS_CHUNK_SIZE 65536
+
+LogFileWriter::LogFileWriter(QString filePath, long long maxFileSize, int maxRotatedFiles,
+                             bool compressRotatedFiles, int maxPendingLines, QObject *parent) :
+    QThread(parent),
+    head(NULL),
+    pendingLines(0),
+    droppedLines(0),
+    stopRequested(0),
+    sleeping(0)
+{
+    this->filePath = filePath;
+    this->maxFileSize = maxFileSize;
+    this->maxRotatedFiles = maxRotatedFiles;
+    this->compressRotatedFiles = compressRotatedFiles;
+    this->maxPendingLines = maxPendingLines;
+    currentSize = 0;
+
+    tail = new Node();
+    tail->next.fetchAndStoreRelease(NULL);
+    head.fetchAndStoreRelease(tail);
+}
+
+LogFileWriter::~LogFileWriter()
+{
+    stop();
+
+    QByteArray line;
+    while (dequeue(line));
+    delete tail;
+}
+
+bool LogFileWriter::enqueue(const QByteArray &line)
+{
+    if (pendingLines.fetchAndAddRelaxed(1) >= maxPendingLines)
+    {
+        pendingLines.fetchAndAddRelaxed(-1);
+        droppedLines.fetchAndAddRelaxed(1);
+        return false;
+    }
+
+    Node *node = new Node();
+    node->next.fetchAndStoreRelaxed(NULL);
+    node->data = line;
+
+    Node *prev = head.fetchAndStoreOrdered(node);
+    prev->next.fetchAndStoreOrdered(node);
+
+    // the writer checks the queue after setting sleeping, so either it
+    // sees this line or it is woken here
+    if (sleeping.fetchAndAddOrdered(0))
+    {
+        wakeWriter();
+    }
+    return true;
+}
+
+void LogFileWriter::wakeWriter()
+{
+    waitMutex.lock();
+    wakeCondition.wakeOne();
+    waitMutex.unlock();
+}
+
+void LogFileWriter::startWriting()
+{
+    if (isRunning())
+    {
+        return;
+    }
+
+    stopRequested.fetchAndStoreOrdered(0);
+    start(QThread::LowPriority);
+}
+
+void LogFileWriter::stop()
+{
+    stopRequested.fetchAndStoreOrdered(1);
+    wakeWriter();
+    wait();
+}
+
+// Only called by the writer thread. The node that holds the data becomes the new stub
+bool LogFileWriter::dequeue(QByteArray &line)
+{
+    Node *next = tail->next.fetchAndAddAcquire(0);
+    if (!next)
+    {
+        return false;
+    }
+
+    line = next->data;
+    next->data.clear();
+    delete tail;
+    tail = next;
+    return true;
+}
+
+// Only called by the writer thread
+bool LogFileWriter::hasPendingLines()
+{
+    return tail->next.fetchAndAddOrdered(0) != NULL;
+}
+
+void LogFileWriter::run()
+{
+    forever
+    {
+        bool stopping = stopRequested.fetchAndAddAcquire(0);
+        bool written = false;
+
+        QByteArray line;
+        while (dequeue(line))
+        {
+            pendingLines.fetchAndAddRelaxed(-1);
+            if (file.isOpen() || openFile())
+            {
+                qint64 bytes = file.write(line);
+                if (bytes > 0)
+                {
+                    currentSize += bytes;
+                }
+                written = true;
+                if (currentSize >= maxFileSize)
+                {
+                    rotate();
+                }
+            }
+        }
+
+        int dropped = droppedLines.fetchAndStoreRelaxed(0);
+        if (dropped && (file.isOpen() || openFile()))
+        {
+            qint64 bytes = file.write(QString::fromUtf8("%1 log lines were dropped\n").arg(dropped).toUtf8());
+            if (bytes > 0)
+            {
+                currentSize += bytes;
+            }
+            written = true;
+        }
+
+        if (written)
+        {
+            file.flush();
+        }
+
+        if (stopping)
+        {
+            break;
+        }
+
+        // wait for new lines, enqueue() and stop() wake the thread
+        waitMutex.lock();
+        sleeping.fetchAndStoreOrdered(1);
+        if (!hasPendingLines() && !stopRequested.fetchAndAddAcquire(0))
+        {
+            bool woken = wakeCondition.wait(&waitMutex, file.isOpen() ? IDLE_CLOSE_MS : ULONG_MAX);
+            if (!woken && !hasPendingLines())
+            {
+                file.close();
+            }
+        }
+        sleeping.fetchAndStoreOrdered(0);
+        waitMutex.unlock();
+    }
+
+    file.close();
+}
+
+bool LogFileWriter::openFile()
+{
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+    {
+        return false;
+    }
+
+    // tracked from here on, asking the file for its size on every line is expensive
+    currentSize = file.size();
+    return true;
+}
+
+QString LogFileWriter::rotatedFilePath(int number, bool compressed) const
+{
+    QString path = filePath + QString::fromUtf8(".%1").arg(number);
+    if (compressed)
+    {
+        path.append(QString::fromUtf8(".gz"));
+    }
+    return path;
+}
+
+// MEGAsync.log -> MEGAsync.log.1[.gz] -> MEGAsync.log.2[.gz] ...
+// Each position holds either a compressed or a plain file (if the compression
+// failed, or the setting changed), both names are shifted together
+void LogFileWriter::rotate()
+{
+    file.close();
+
+    bool discarded = false;
+    if (maxRotatedFiles > 0)
+    {
+        QFile::remove(rotatedFilePath(maxRotatedFiles, false));
+        QFile::remove(rotatedFilePath(maxRotatedFiles, true));
+        for (int i = maxRotatedFiles - 1; i > 0; i--)
+        {
+            QFile::rename(rotatedFilePath(i, false), rotatedFilePath(i + 1, false));
+            QFile::rename(rotatedFilePath(i, true), rotatedFilePath(i + 1, true));
+        }
+
+        // the shift can fail, stale files would block the renames below
+        QFile::remove(rotatedFilePath(1, false));
+        QFile::remove(rotatedFilePath(1, true));
+        if (!compressRotatedFiles || !compressFile(filePath, rotatedFilePath(1, true)))
+        {
+            discarded = !QFile::rename(filePath, rotatedFilePath(1, false));
+        }
+    }
+    QFile::remove(filePath);
+
+    if (openFile() && discarded)
+    {
+        qint64 bytes = file.write("The previous log file couldn't be rotated and was discarded\n");
+        if (bytes > 0)
+        {
+            currentSize += bytes;
+        }
+    }
+}
+
+// Writes a gzip file, the source is read and compressed in chunks
+bool LogFileWriter::compressFile(const QString &sourcePath, const QString &destinationPath)
+{
+    QFile source(sourcePath);
+    if (!source.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QFile destination(destinationPath);
+    if (!destination.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // 16 + MAX_WBITS selects the gzip format
+    if (deflateInit2(&stream, 6, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        destination.close();
+        QFile::remove(destinationPath);
+        return false;
+    }
+
+    QByteArray input(COMPRESS_CHUNK_SIZE, 0);
+    QByteArray output(COMPRESS_CHUNK_SIZE, 0);
+    bool ok = true;
+    int flush;
+    do
+    {
+        qint64 len = source.read(input.data(), input.size());
+        if (len < 0)
+        {
+            ok = false;
+            break;
+        }
+
+        flush = source.atEnd() ? Z_FINISH : Z_NO_FLUSH;
+        stream.next_in = (Bytef *)input.data();
+        stream.avail_in = (uInt)len;
+        do
+        {
+            stream.next_out = (Bytef *)output.data();
+            stream.avail_out = output.size();
+            if (deflate(&stream, flush) == Z_STREAM_ERROR)
+            {
+                ok = false;
+                break;
+            }
+
+            qint64 compressed = output.size() - stream.avail_out;
+            if (destination.write(output.constData(), compressed) != compressed)
+            {
+                ok = false;
+                break;
+            }
+        } while (stream.avail_out == 0);
+    } while (ok && flush != Z_FINISH);
+
+    deflateEnd(&stream);
+    source.close();
+    destination.close();
+    if (!ok)
+    {
+        QFile::remove(destinationPath);
+    }
+    return ok;
+}
@@ -0,0 +1,75 @@
+#ifndef LOGFILEWRITER_H
+#define LOGFILEWRITER_H
+
+#include <QThread>
+#include <QAtomicPointer>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QString>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+
+/*
+ * Writes log lines to a file from a dedicated thread.
+ *
+ * Producers only push the line to a lock-free multiple-producer single-consumer queue.
+ * If the queue is full the line is dropped and counted, and the number of dropped lines
+ * is written to the file later. The writer thread sleeps until there are new lines.
+ * The file is rotated when it reaches maxFileSize, and the rotated files can be compressed
+ * with gzip.
+ */
+class LogFileWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    LogFileWriter(QString filePath, long long maxFileSize, int maxRotatedFiles,
+                  bool compressRotatedFiles, int maxPendingLines, QObject *parent = 0);
+    ~LogFileWriter();
+
+    // Can be called from any thread, returns false if the line was dropped
+    bool enqueue(const QByteArray &line);
+    void startWriting();
+    // writes the pending lines and stops the thread
+    void stop();
+
+protected:
+    void run();
+
+private:
+    struct Node
+    {
+        QAtomicPointer<Node> next;
+        QByteArray data;
+    };
+
+    bool dequeue(QByteArray &line);
+    bool hasPendingLines();
+    void wakeWriter();
+    bool openFile();
+    void rotate();
+    QString rotatedFilePath(int number, bool compressed) const;
+    static bool compressFile(const QString &sourcePath, const QString &destinationPath);
+
+    QString filePath;
+    long long maxFileSize;
+    int maxRotatedFiles;
+    bool compressRotatedFiles;
+    int maxPendingLines;
+
+    QAtomicPointer<Node> head; // last pushed node, shared by producers
+    Node *tail; // stub node, only used by the writer thread
+    QAtomicInt pendingLines;
+    QAtomicInt droppedLines;
+    QAtomicInt stopRequested;
+    // set while the writer thread waits for new lines
+    QAtomicInt sleeping;
+    QMutex waitMutex;
+    QWaitCondition wakeCondition;
+
+    QFile file;
+    qint64 currentSize;
+};
+
+#endif // LOGFILEWRITER_H
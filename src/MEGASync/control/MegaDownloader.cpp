@@ -3,22 +3,38 @@
 #include <QApplication>
 #include <QDateTime>
 
+// Remote nodes walked in each iteration of the event loop
+#define EXPAND_BATCH_SIZE 1000
+// startDownload calls made in each iteration of the event loop
+#define DOWNLOAD_BATCH_SIZE 500
+// Minimum time between the estimates sent while walking the folders
+#define ESTIMATE_INTERVAL_MS 1000
+
 using namespace mega;
 
 MegaDownloader::MegaDownloader(MegaApi *megaApi, MegaApi *megaApiGuest) : QObject()
 {
     this->megaApi = megaApi;
     this->megaApiGuest = megaApiGuest;
+    numFiles = 0;
+    numBytes = 0;
+
+    processTimer.setSingleShot(true);
+    processTimer.setInterval(0);
+    connect(&processTimer, SIGNAL(timeout()), this, SLOT(processPendingNodes()));
 }
 
 MegaDownloader::~MegaDownloader()
 {
+    while (!foldersToExpand.isEmpty())
+    {
+        delete foldersToExpand.dequeue().node;
+    }
 
-}
-
-void MegaDownloader::download(MegaNode *parent, QString path)
-{
-    return download(parent, QFileInfo(path));
+    while (!pendingDownloads.isEmpty())
+    {
+        delete pendingDownloads.dequeue().node;
+    }
 }
 
 void MegaDownloader::processDownloadQueue(QQueue<MegaNode *> *downloadQueue, QString path)
@@ -44,62 +60,160 @@ void MegaDownloader::processDownloadQueue(QQueue<MegaNode *> *downloadQueue, QSt
             currentPath = path;
         }
 
-        download(node, currentPath);
-        delete node;
+        addNode(node, QDir::toNativeSeparators(QFileInfo(currentPath).absoluteFilePath()));
     }
     pathMap.clear();
+
+    emit estimate(foldersToExpand.isEmpty() ? numFiles : -1, numBytes);
+    estimateTimer.start();
+    if (!processTimer.isActive())
+    {
+        processTimer.start();
+    }
 }
 
-void MegaDownloader::download(MegaNode *parent, QFileInfo info)
+// Takes the ownership of the node
+void MegaDownloader::addNode(MegaNode *node, QString path)
 {
-    QApplication::processEvents();
+    PendingNode pending;
+    pending.node = node;
+    pending.localPath = path;
 
-    QString currentPath = QDir::toNativeSeparators(info.absoluteFilePath());
+    if (node->getType() == MegaNode::TYPE_FILE)
+    {
+        numFiles++;
+        numBytes += node->getSize();
+        pendingDownloads.enqueue(pending);
+        return;
+    }
+
+    char *escapedName = megaApi->escapeFsIncompatible(node->getName());
+    QString nodeName = QString::fromUtf8(escapedName);
+    delete [] escapedName;
 
-    if (parent->getType() == MegaNode::TYPE_FILE)
+    pending.localPath = path + QDir::separator() + nodeName;
+    if (!createLocalFolder(pending.localPath))
     {
-        if ((parent->isPublic() || parent->isForeign()) && megaApiGuest)
-        {
-            megaApiGuest->startDownload(parent, (currentPath + QDir::separator()).toUtf8().constData());
-        }
-        else
-        {
-            megaApi->startDownload(parent, (currentPath + QDir::separator()).toUtf8().constData());
-        }
+        delete node;
+        return;
     }
-    else
+
+    if (node->isForeign())
     {
-        char *escapedName = megaApi->escapeFsIncompatible(parent->getName());
-        QString nodeName = QString::fromUtf8(escapedName);
-        delete [] escapedName;
+        // the children of public folders come in the download queue
+        pathMap[node->getHandle()] = pending.localPath;
+        delete node;
+        return;
+    }
+
+    // the files inside are counted while the tree is walked
+    foldersToExpand.enqueue(pending);
+}
+
+bool MegaDownloader::createLocalFolder(QString path)
+{
+    QDir dir(path);
+    if (dir.exists())
+    {
+        return true;
+    }
 
-        QString destPath = currentPath + QDir::separator() + nodeName;
-        QDir dir(destPath);
-        if (!dir.exists())
-        {
 #ifndef WIN32
-            if (!megaApi->createLocalFolder(dir.toNativeSeparators(destPath).toStdString().c_str()))
+    return megaApi->createLocalFolder(dir.toNativeSeparators(path).toStdString().c_str());
 #else
-            if (!dir.mkpath(QString::fromAscii(".")))
+    return dir.mkpath(QString::fromAscii("."));
 #endif
-            {
-                return;
-            }
+}
+
+void MegaDownloader::processPendingNodes()
+{
+    if (!foldersToExpand.isEmpty())
+    {
+        // the local folders are created before starting any download
+        int walked = 0;
+        while (walked < EXPAND_BATCH_SIZE && !foldersToExpand.isEmpty())
+        {
+            PendingNode folder = foldersToExpand.dequeue();
+            walked += expandFolder(folder) + 1;
+            delete folder.node;
         }
 
-        if (!parent->isForeign())
+        if (foldersToExpand.isEmpty())
         {
-            MegaNodeList *nList = megaApi->getChildren(parent);
-            for (int i = 0; i < nList->size(); i++)
-            {
-                MegaNode *child = nList->get(i);
-                download(child, destPath);
-            }
-            delete nList;
+            emit estimate(numFiles, numBytes);
         }
-        else
+        else if (estimateTimer.elapsed() >= ESTIMATE_INTERVAL_MS)
+        {
+            // partial size, it grows while the folders are walked
+            emit estimate(-1, numBytes);
+            estimateTimer.start();
+        }
+        processTimer.start();
+        return;
+    }
+
+    for (int i = 0; i < DOWNLOAD_BATCH_SIZE && !pendingDownloads.isEmpty(); i++)
+    {
+        PendingNode file = pendingDownloads.dequeue();
+        startDownload(file);
+        delete file.node;
+    }
+
+    if (!pendingDownloads.isEmpty())
+    {
+        processTimer.start();
+        return;
+    }
+
+    numFiles = 0;
+    numBytes = 0;
+    emit preparationFinished();
+}
+
+// Returns the number of children
+int MegaDownloader::expandFolder(const PendingNode &folder)
+{
+    MegaNodeList *nList = megaApi->getChildren(folder.node);
+    int numChildren = nList->size();
+    for (int i = 0; i < nList->size(); i++)
+    {
+        MegaNode *child = nList->get(i);
+        if (child->getType() == MegaNode::TYPE_FILE)
+        {
+            PendingNode file;
+            file.node = child->copy();
+            file.localPath = folder.localPath;
+            pendingDownloads.enqueue(file);
+            numFiles++;
+            numBytes += child->getSize();
+            continue;
+        }
+
+        char *escapedName = megaApi->escapeFsIncompatible(child->getName());
+        QString childPath = folder.localPath + QDir::separator() + QString::fromUtf8(escapedName);
+        delete [] escapedName;
+
+        if (createLocalFolder(childPath))
         {
-            pathMap[parent->getHandle()] = destPath;
+            PendingNode subfolder;
+            subfolder.node = child->copy();
+            subfolder.localPath = childPath;
+            foldersToExpand.enqueue(subfolder);
         }
     }
+    delete nList;
+    return numChildren;
+}
+
+void MegaDownloader::startDownload(const PendingNode &file)
+{
+    QByteArray localPath = (file.localPath + QDir::separator()).toUtf8();
+    if ((file.node->isPublic() || file.node->isForeign()) && megaApiGuest)
+    {
+        megaApiGuest->startDownload(file.node, localPath.constData());
+    }
+    else
+    {
+        megaApi->startDownload(file.node, localPath.constData());
+    }
 }
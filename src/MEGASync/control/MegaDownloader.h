@@ -7,8 +7,15 @@
 #include <QDir>
 #include <QQueue>
 #include <QMap>
+#include <QTimer>
+#include <QElapsedTimer>
 #include "megaapi.h"
 
+/*
+ * Downloads are prepared in the event loop, a few nodes per iteration:
+ * first the remote folders are walked breadth-first creating the local folders,
+ * then the file downloads are started in batches.
+ */
 class MegaDownloader : public QObject
 {
     Q_OBJECT
@@ -19,14 +26,38 @@ public:
     MegaDownloader(mega::MegaApi *megaApi, mega::MegaApi *megaApiGuest = NULL);
     virtual ~MegaDownloader();
     void processDownloadQueue(QQueue<mega::MegaNode *> *downloadQueue, QString path);
-    void download(mega::MegaNode *parent, QString path);
+
+signals:
+    // numFiles is -1 until all the folders have been walked,
+    // until then numBytes only includes the files found so far
+    void estimate(long long numFiles, long long numBytes);
+    void preparationFinished();
+
+protected slots:
+    void processPendingNodes();
 
 protected:
-    void download(mega::MegaNode *parent, QFileInfo info);
+    struct PendingNode
+    {
+        mega::MegaNode *node;
+        QString localPath;
+    };
+
+    void addNode(mega::MegaNode *node, QString path);
+    bool createLocalFolder(QString path);
+    int expandFolder(const PendingNode &folder);
+    void startDownload(const PendingNode &file);
 
     mega::MegaApi *megaApi;
     mega::MegaApi *megaApiGuest;
     QMap<mega::MegaHandle, QString> pathMap;
+
+    QQueue<PendingNode> foldersToExpand;
+    QQueue<PendingNode> pendingDownloads;
+    QTimer processTimer;
+    QElapsedTimer estimateTimer;
+    long long numFiles;
+    long long numBytes;
 };
 
 #endif // MEGADOWNLOADER_H
@@ -1,5 +1,6 @@
 #include "MegaSyncLogger.h"
 #include "Utilities.h"
+#include "Preferences.h"
 
 #include <iostream>
 #include <sstream>
@@ -8,11 +9,23 @@
 #include <QString>
 #include <QDesktopServices>
 #include <QDir>
+#include <QDateTime>
+#include <QtEndian>
 
 #define MEGA_LOGGER QString::fromUtf8("MEGA_LOGGER")
 #define ENABLE_MEGASYNC_LOGS QString::fromUtf8("MEGA_ENABLE_LOGS")
 #define MAX_MESSAGE_SIZE 4096
 
+// Binary stream: MAGIC + start time (qint64, ms since epoch) followed by records:
+// size of the rest of the record (quint32), log level (quint8),
+// microseconds since the start time (quint64), UTF-8 message
+// All numbers are little endian. MEGAlogger sends MAGIC when it supports this format.
+#define BINARY_STREAM_MAGIC "MLB1"
+#define BINARY_RECORD_HEADER_SIZE 13
+#define NEGOTIATION_TIMEOUT_MS 1000
+#define BINARY_FLUSH_INTERVAL_MS 50
+#define MAX_PENDING_BINARY_BYTES (8 * 1024 * 1024)
+
 using namespace mega;
 using namespace std;
 
@@ -24,6 +37,17 @@ MegaSyncLogger::MegaSyncLogger(QObject *parent) : QObject(parent), MegaLogger()
     logToFile = false;
     client = NULL;
     megaServer = NULL;
+    fileWriter = NULL;
+    droppedRecords = 0;
+    streamFormat.fetchAndStoreOrdered(STREAM_FORMAT_UNKNOWN);
+    monotonicTimer.start();
+    startTime = QDateTime::currentMSecsSinceEpoch();
+
+    negotiationTimer.setSingleShot(true);
+    negotiationTimer.setInterval(NEGOTIATION_TIMEOUT_MS);
+    connect(&negotiationTimer, SIGNAL(timeout()), this, SLOT(onNegotiationTimeout()));
+    flushTimer.setInterval(BINARY_FLUSH_INTERVAL_MS);
+    connect(&flushTimer, SIGNAL(timeout()), this, SLOT(flushBinaryRecords()));
 
 #ifdef LOG_TO_LOGGER
     QLocalServer::removeServer(ENABLE_MEGASYNC_LOGS);
@@ -38,6 +62,7 @@ MegaSyncLogger::MegaSyncLogger(QObject *parent) : QObject(parent), MegaLogger()
 
     megaServer->listen(ENABLE_MEGASYNC_LOGS);
     client->connectToServer(MEGA_LOGGER);
+    startStream();
 #endif
 }
 
@@ -49,12 +74,15 @@ MegaSyncLogger::~MegaSyncLogger()
     {
         delete megaServer;
     }
+
+    delete fileWriter;
 }
 
 void MegaSyncLogger::log(const char *time, int loglevel, const char *source, const char *message)
 {
 #ifdef LOG_TO_LOGGER
-    if (connected)
+    // records are also kept while the format is being negotiated
+    if (connected && !appendBinaryRecord(loglevel, source, message))
     {
         QString m = QString::fromUtf8(message);
         if (m.size() > MAX_MESSAGE_SIZE)
@@ -117,35 +145,11 @@ void MegaSyncLogger::log(const char *time, int loglevel, const char *source, con
             cout << oss.str() << endl;
         }
 
-        if (logToFile)
+        if (logToFile && fileWriter)
         {
-            static QString filePath;
-            if (filePath.isEmpty())
-            {
-                QString dataPath;
-#if QT_VERSION < 0x050000
-                dataPath = QDesktopServices::storageLocation(QDesktopServices::DesktopLocation);
-#else
-                QStringList desktopPaths = QStandardPaths::standardLocations(QStandardPaths::DesktopLocation);
-                if (desktopPaths.size())
-                {
-                    dataPath = desktopPaths.at(0);
-                }
-                else
-                {
-                    dataPath = Utilities::getDefaultBasePath();
-                }
-#endif
-                filePath = dataPath + QDir::separator() + QString::fromAscii("MEGAsync.log");
-            }
-
-            QFile file(filePath);
-            if (file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
-            {
-                QTextStream out(&file);
-                out.setCodec("UTF-8");
-                out << QString::fromUtf8(oss.str().c_str()) << endl;
-            }
+            oss << "\n";
+            string line = oss.str();
+            fileWriter->enqueue(QByteArray(line.data(), int(line.size())));
         }
     }
 }
@@ -157,7 +161,38 @@ void MegaSyncLogger::sendLogsToStdout(bool enable)
 
 void MegaSyncLogger::sendLogsToFile(bool enable)
 {
+    if (enable && !fileWriter)
+    {
+        QString dataPath;
+#if QT_VERSION < 0x050000
+        dataPath = QDesktopServices::storageLocation(QDesktopServices::DesktopLocation);
+#else
+        QStringList desktopPaths = QStandardPaths::standardLocations(QStandardPaths::DesktopLocation);
+        if (desktopPaths.size())
+        {
+            dataPath = desktopPaths.at(0);
+        }
+        else
+        {
+            dataPath = Utilities::getDefaultBasePath();
+        }
+#endif
+        QString filePath = dataPath + QDir::separator() + QString::fromAscii("MEGAsync.log");
+        fileWriter = new LogFileWriter(filePath, Preferences::MAX_LOG_FILE_SIZE,
+                                       Preferences::MAX_ROTATED_LOG_FILES, true,
+                                       Preferences::MAX_PENDING_LOG_LINES);
+    }
+
+    // the writer is kept once created because other threads could be using it
+    if (enable)
+    {
+        fileWriter->startWriting();
+    }
     this->logToFile = enable;
+    if (!enable && fileWriter)
+    {
+        fileWriter->stop();
+    }
 }
 
 bool MegaSyncLogger::isLogToStdoutEnabled()
@@ -249,12 +284,21 @@ void MegaSyncLogger::clientConnected()
     connect(client, SIGNAL(disconnected()), this, SLOT(disconnected()));
     connect(client, SIGNAL(error(QLocalSocket::LocalSocketError)), SLOT(disconnected()));
     client->connectToServer(MEGA_LOGGER);
+    startStream();
     connected = true;
 }
 
 void MegaSyncLogger::disconnected()
 {
     connected = false;
+    negotiationTimer.stop();
+    flushTimer.stop();
+    streamFormat.fetchAndStoreOrdered(STREAM_FORMAT_UNKNOWN);
+    binaryMutex.lock();
+    binaryRecords.clear();
+    droppedRecords = 0;
+    binaryMutex.unlock();
+
     if (xmlWriter)
     {
         delete xmlWriter;
@@ -267,3 +311,170 @@ void MegaSyncLogger::disconnected()
         client = NULL;
     }
 }
+
+// wait for MEGAlogger to announce the binary format, old versions only understand XML
+void MegaSyncLogger::startStream()
+{
+    streamFormat.fetchAndStoreOrdered(STREAM_FORMAT_UNKNOWN);
+    connect(client, SIGNAL(readyRead()), this, SLOT(onLoggerData()));
+    negotiationTimer.start();
+}
+
+void MegaSyncLogger::onLoggerData()
+{
+    if (!client)
+    {
+        return;
+    }
+
+    if (streamFormat.fetchAndAddRelaxed(0) != STREAM_FORMAT_UNKNOWN)
+    {
+        client->readAll();
+        return;
+    }
+
+    if (client->bytesAvailable() < (qint64)strlen(BINARY_STREAM_MAGIC))
+    {
+        return;
+    }
+
+    QByteArray hello = client->readAll();
+    if (!hello.startsWith(BINARY_STREAM_MAGIC))
+    {
+        return;
+    }
+
+    negotiationTimer.stop();
+    uchar start[8];
+    qToLittleEndian<qint64>(startTime, start);
+    client->write(BINARY_STREAM_MAGIC);
+    client->write((const char *)start, sizeof(start));
+    streamFormat.fetchAndStoreOrdered(STREAM_FORMAT_BINARY);
+    flushBinaryRecords();
+    flushTimer.start();
+}
+
+// the viewer doesn't support the binary format, convert the records received meanwhile
+void MegaSyncLogger::onNegotiationTimeout()
+{
+    if (streamFormat.fetchAndAddRelaxed(0) != STREAM_FORMAT_UNKNOWN)
+    {
+        return;
+    }
+
+    binaryMutex.lock();
+    streamFormat.fetchAndStoreOrdered(STREAM_FORMAT_XML);
+    QByteArray records = binaryRecords;
+    binaryRecords.clear();
+    binaryMutex.unlock();
+
+    int pos = 0;
+    while (pos + BINARY_RECORD_HEADER_SIZE <= records.size())
+    {
+        const uchar *header = (const uchar *)records.constData() + pos;
+        int size = qFromLittleEndian<quint32>(header);
+        int loglevel = header[4];
+        qint64 timestamp = startTime + qFromLittleEndian<quint64>(header + 5) / 1000;
+        QString message = QString::fromUtf8(records.constData() + pos + BINARY_RECORD_HEADER_SIZE,
+                                            size - (BINARY_RECORD_HEADER_SIZE - 4));
+        onLogAvailable(QDateTime::fromMSecsSinceEpoch(timestamp).toString(QString::fromUtf8("dd/MM-hh:mm:ss")),
+                       loglevel, message);
+        pos += size + 4;
+    }
+}
+
+// called from any thread, returns false if the viewer only understands XML
+bool MegaSyncLogger::appendBinaryRecord(int loglevel, const char *source, const char *message)
+{
+    int messageSize = strlen(message);
+    if (messageSize > MAX_MESSAGE_SIZE)
+    {
+        // don't cut a multibyte UTF-8 character
+        messageSize = MAX_MESSAGE_SIZE;
+        while (messageSize > 0 && (message[messageSize] & 0xC0) == 0x80)
+        {
+            messageSize--;
+        }
+    }
+
+    const char *fileName = NULL;
+    int fileNameSize = 0;
+#ifdef DEBUG
+    if (source)
+    {
+        fileName = source;
+        for (const char *p = source; *p; p++)
+        {
+            if (*p == '/' || *p == '\\')
+            {
+                fileName = p + 1;
+            }
+        }
+        fileNameSize = strlen(fileName);
+    }
+#else
+    (void)source;
+#endif
+
+    int payloadSize = messageSize + (fileNameSize ? fileNameSize + 3 : 0);
+    uchar header[BINARY_RECORD_HEADER_SIZE];
+    qToLittleEndian<quint32>(BINARY_RECORD_HEADER_SIZE - 4 + payloadSize, header);
+    header[4] = (uchar)loglevel;
+    qToLittleEndian<quint64>(monotonicTimer.nsecsElapsed() / 1000, header + 5);
+
+    // checked under the same lock used to switch to XML, so no record
+    // is appended after the pending ones have been converted
+    QMutexLocker locker(&binaryMutex);
+    if (streamFormat.fetchAndAddRelaxed(0) == STREAM_FORMAT_XML)
+    {
+        return false;
+    }
+
+    if (binaryRecords.size() > MAX_PENDING_BINARY_BYTES)
+    {
+        droppedRecords++;
+        return true;
+    }
+
+    binaryRecords.append((const char *)header, BINARY_RECORD_HEADER_SIZE);
+    binaryRecords.append(message, messageSize);
+    if (fileNameSize)
+    {
+        binaryRecords.append(" (", 2);
+        binaryRecords.append(fileName, fileNameSize);
+        binaryRecords.append(')');
+    }
+    return true;
+}
+
+// write the pending records in a single batch
+void MegaSyncLogger::flushBinaryRecords()
+{
+    if (!client || streamFormat.fetchAndAddRelaxed(0) != STREAM_FORMAT_BINARY)
+    {
+        return;
+    }
+
+    binaryMutex.lock();
+    QByteArray records = binaryRecords;
+    binaryRecords.clear();
+    int dropped = droppedRecords;
+    droppedRecords = 0;
+    binaryMutex.unlock();
+
+    if (dropped)
+    {
+        QByteArray message = QString::fromUtf8("%1 log messages were dropped").arg(dropped).toUtf8();
+        uchar header[BINARY_RECORD_HEADER_SIZE];
+        qToLittleEndian<quint32>(BINARY_RECORD_HEADER_SIZE - 4 + message.size(), header);
+        header[4] = (uchar)MegaApi::LOG_LEVEL_WARNING;
+        qToLittleEndian<quint64>(monotonicTimer.nsecsElapsed() / 1000, header + 5);
+        client->write((const char *)header, BINARY_RECORD_HEADER_SIZE);
+        client->write(message);
+    }
+
+    if (records.size())
+    {
+        client->write(records);
+    }
+}
@@ -4,8 +4,13 @@
 #include <QLocalSocket>
 #include <QLocalServer>
 #include <QXmlStreamWriter>
+#include <QMutex>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QAtomicInt>
 
 #include "megaapi.h"
+#include "LogFileWriter.h"
 
 class MegaSyncLogger : public QObject, public mega::MegaLogger
 {
@@ -27,14 +32,37 @@ public slots:
     void onLogAvailable(QString time, int loglevel, QString message);
     void clientConnected();
     void disconnected();
+    void onLoggerData();
+    void onNegotiationTimeout();
+    void flushBinaryRecords();
 
 protected:
+    // format of the stream sent to MEGAlogger
+    enum {
+        STREAM_FORMAT_UNKNOWN = 0, // waiting for the viewer to announce binary support
+        STREAM_FORMAT_XML,
+        STREAM_FORMAT_BINARY
+    };
+
+    void startStream();
+    bool appendBinaryRecord(int loglevel, const char *source, const char *message);
+
     QLocalSocket* client;
     QLocalServer* megaServer;
     QXmlStreamWriter *xmlWriter;
     bool connected;
     bool logToStdout;
     bool logToFile;
+    LogFileWriter *fileWriter;
+
+    QAtomicInt streamFormat;
+    QMutex binaryMutex;
+    QByteArray binaryRecords; // pending records, written in batches
+    int droppedRecords;
+    QTimer flushTimer;
+    QTimer negotiationTimer;
+    QElapsedTimer monotonicTimer;
+    qint64 startTime; // ms since epoch when monotonicTimer started
 };
 
 #endif // MEGASYNCLOGGER_H
@@ -5,32 +5,283 @@
 #include <QtCore>
 #include <QApplication>
 
-#if QT_VERSION >= 0x050000
-#include <QtConcurrent/QtConcurrent>
-#endif
+// Entries sent by the scanner in each batch
+#define SCAN_BATCH_SIZE 1000
+// createFolder requests in flight at the same time
+#define MAX_ACTIVE_FOLDER_REQUESTS 32
+// startUpload calls made in each iteration of the event loop
+#define UPLOAD_BATCH_SIZE 500
+#define PROGRESS_INTERVAL_MS 500
 
 using namespace mega;
 using namespace std;
 
+FolderScanner::FolderScanner() : QObject(), cancelled(0)
+{
+}
+
+void FolderScanner::cancel()
+{
+    cancelled.fetchAndStoreRelaxed(1);
+}
+
+void FolderScanner::scan(int jobId, QString path)
+{
+    UploadScanBatch batch;
+    batch.jobId = jobId;
+    batch.finished = false;
+
+    // breadth-first, so that the remote folders can be created while the scan goes on
+    QQueue<QPair<int, QString> > folders;
+    folders.enqueue(qMakePair(0, path));
+    int nextFolder = 1;
+    while (!folders.isEmpty() && !cancelled.fetchAndAddRelaxed(0))
+    {
+        QPair<int, QString> folder = folders.dequeue();
+        QDirIterator it(folder.second, QDir::AllEntries | QDir::NoDotAndDotDot);
+        while (it.hasNext())
+        {
+            it.next();
+            QFileInfo info = it.fileInfo();
+            if (info.isDir())
+            {
+                batch.folderPaths.append(info.absoluteFilePath());
+                batch.folderParents.append(folder.first);
+                folders.enqueue(qMakePair(nextFolder++, info.absoluteFilePath()));
+            }
+            else if (info.isFile())
+            {
+                batch.filePaths.append(info.absoluteFilePath());
+                batch.fileFolders.append(folder.first);
+            }
+
+            if (batch.folderPaths.size() + batch.filePaths.size() >= SCAN_BATCH_SIZE)
+            {
+                emit scanned(batch);
+                batch.folderPaths.clear();
+                batch.folderParents.clear();
+                batch.filePaths.clear();
+                batch.fileFolders.clear();
+            }
+        }
+    }
+
+    batch.finished = true;
+    emit scanned(batch);
+}
+
 MegaUploader::MegaUploader(MegaApi *megaApi) : QObject()
 {
     this->megaApi = megaApi;
     delegateListener = new QTMegaRequestListener(megaApi, this);
+    nextJobId = 0;
+    activeFolderRequests = 0;
+    scannedItems = 0;
+    resolvedFolders = 0;
+    totalFolders = 0;
+    processedFiles = 0;
+    totalFiles = 0;
+
+    qRegisterMetaType<UploadScanBatch>("UploadScanBatch");
+    scannerThread = new QThread();
+    scanner = new FolderScanner();
+    scanner->moveToThread(scannerThread);
+    connect(this, SIGNAL(scanFolder(int, QString)), scanner, SLOT(scan(int, QString)), Qt::QueuedConnection);
+    connect(scanner, SIGNAL(scanned(UploadScanBatch)), this, SLOT(onFolderScanned(UploadScanBatch)), Qt::QueuedConnection);
+    scannerThread->start(QThread::LowPriority);
+
+    uploadTimer.setSingleShot(true);
+    uploadTimer.setInterval(0);
+    connect(&uploadTimer, SIGNAL(timeout()), this, SLOT(startPendingUploads()));
+
+    progressTimer.setInterval(PROGRESS_INTERVAL_MS);
+    connect(&progressTimer, SIGNAL(timeout()), this, SLOT(reportProgress()));
+
+    localCopier = new LocalCopier(this);
+    connect(localCopier, SIGNAL(progress(long long, long long)), this, SIGNAL(localCopyProgress(long long, long long)));
+    connect(localCopier, SIGNAL(finished(bool)), this, SIGNAL(localCopyFinished(bool)));
 }
 
 MegaUploader::~MegaUploader()
 {
+    scanner->cancel();
+    scannerThread->quit();
+    scannerThread->wait();
+    delete scanner;
+    delete scannerThread;
+    delete localCopier;
     delete delegateListener;
 }
 
 void MegaUploader::upload(QString path, MegaNode *parent)
 {
-    return upload(QFileInfo(path), parent);
+    QFileInfo info(path);
+    QString fileName = uploadName(info);
+    QByteArray utf8name = fileName.toUtf8();
+    QString currentPath = QDir::toNativeSeparators(info.absoluteFilePath());
+    if (info.isDir())
+    {
+        MegaNode *child = megaApi->getChildNode(parent, utf8name.constData());
+        if (child && child->getType() == MegaNode::TYPE_FOLDER)
+        {
+            startJob(info.absoluteFilePath(), fileName, parent->getHandle(), child);
+            delete child;
+            return;
+        }
+        delete child;
+    }
+
+    if (copyToLocalFolder(currentPath, fileName, localFolderOf(parent)))
+    {
+        return;
+    }
+
+    if (info.isFile())
+    {
+        megaApi->startUpload(currentPath.toUtf8().constData(), parent);
+    }
+    else if (info.isDir())
+    {
+        startJob(info.absoluteFilePath(), fileName, parent->getHandle(), NULL);
+    }
+}
+
+void MegaUploader::onRequestFinish(MegaApi *, MegaRequest *request, MegaError *e)
+{
+    switch(request->getType())
+    {
+        case MegaRequest::TYPE_CREATE_FOLDER:
+        {
+            QString key = QString::number(request->getParentHandle()) + QString::fromUtf8("/")
+                    + QString::fromUtf8(request->getName());
+            QHash<QString, QQueue<QPair<int, int> > >::iterator it = creatingFolders.find(key);
+            if (it == creatingFolders.end())
+            {
+                break;
+            }
+
+            QPair<int, int> folder = it.value().dequeue();
+            if (it.value().isEmpty())
+            {
+                creatingFolders.erase(it);
+            }
+            activeFolderRequests--;
+
+            if (jobs.contains(folder.first))
+            {
+                if (e->getErrorCode() == MegaError::API_OK)
+                {
+                    setFolderReady(folder.first, folder.second, FOLDER_CREATED, request->getNodeHandle(), QString());
+                }
+                else
+                {
+                    MegaApi::log(MegaApi::LOG_LEVEL_ERROR, QString::fromUtf8("Unable to create remote folder for %1: %2")
+                                 .arg(jobs[folder.first].folders.at(folder.second).path)
+                                 .arg(QString::fromUtf8(e->getErrorString())).toUtf8().constData());
+                    skipFolder(folder.first, folder.second);
+                }
+            }
+
+            while (activeFolderRequests < MAX_ACTIVE_FOLDER_REQUESTS && !foldersToCreate.isEmpty())
+            {
+                QPair<int, int> next = foldersToCreate.dequeue();
+                createFolder(next.first, next.second);
+            }
+
+            checkJobFinished(folder.first);
+            break;
+        }
+    }
+}
+
+void MegaUploader::onFolderScanned(UploadScanBatch batch)
+{
+    if (!jobs.contains(batch.jobId))
+    {
+        return;
+    }
+
+    scannedItems += batch.folderPaths.size() + batch.filePaths.size();
+    for (int i = 0; i < batch.folderPaths.size(); i++)
+    {
+        UploadFolder folder;
+        folder.path = batch.folderPaths.at(i);
+        folder.name = folder.path.mid(folder.path.lastIndexOf(QChar::fromLatin1('/')) + 1);
+        folder.parent = batch.folderParents.at(i);
+        folder.state = FOLDER_WAITING;
+        folder.handle = INVALID_HANDLE;
+        addFolder(batch.jobId, folder);
+    }
+
+    totalFiles += batch.filePaths.size();
+    for (int i = 0; i < batch.filePaths.size(); i++)
+    {
+        addFile(batch.jobId, batch.fileFolders.at(i), batch.filePaths.at(i));
+    }
+
+    if (batch.finished)
+    {
+        jobs[batch.jobId].scanFinished = true;
+    }
+    checkJobFinished(batch.jobId);
+}
+
+void MegaUploader::startPendingUploads()
+{
+    MegaNode *parent = NULL;
+    for (int i = 0; i < UPLOAD_BATCH_SIZE && !pendingUploads.isEmpty(); i++)
+    {
+        PendingUpload upload = pendingUploads.dequeue();
+        if (!parent || parent->getHandle() != upload.parent)
+        {
+            delete parent;
+            parent = megaApi->getNodeByHandle(upload.parent);
+        }
+
+        if (parent)
+        {
+            megaApi->startUpload(upload.localPath.constData(), parent);
+        }
+        processedFiles++;
+    }
+    delete parent;
+
+    if (!pendingUploads.isEmpty())
+    {
+        uploadTimer.start();
+        return;
+    }
+    checkFinished();
+}
+
+void MegaUploader::reportProgress()
+{
+    bool scanning = false;
+    for (QHash<int, UploadJob>::const_iterator it = jobs.constBegin(); it != jobs.constEnd(); ++it)
+    {
+        if (!it.value().scanFinished)
+        {
+            scanning = true;
+            break;
+        }
+    }
+
+    if (scanning)
+    {
+        emit progress(STAGE_SCANNING, scannedItems, -1);
+    }
+    else if (resolvedFolders < totalFolders)
+    {
+        emit progress(STAGE_CREATING_FOLDERS, resolvedFolders, totalFolders);
+    }
+    else
+    {
+        emit progress(STAGE_STARTING_UPLOADS, processedFiles, totalFiles);
+    }
 }
 
-void MegaUploader::upload(QFileInfo info, MegaNode *parent)
+QString MegaUploader::uploadName(const QFileInfo &info)
 {
-    QApplication::processEvents();
     QString fileName = info.fileName();
     if (fileName.isEmpty() && info.isRoot())
     {
@@ -44,79 +295,283 @@ void MegaUploader::upload(QFileInfo info, MegaNode *parent)
             fileName = QString::fromUtf8("Drive");
         }
     }
+    return fileName;
+}
 
-    QByteArray utf8name = fileName.toUtf8();
-    QString currentPath = QDir::toNativeSeparators(info.absoluteFilePath());
-    if (info.isDir())
+QString MegaUploader::localFolderOf(MegaNode *node)
+{
+    string localPath = megaApi->getLocalPath(node);
+    if (!localPath.size())
     {
-        MegaNode *child = megaApi->getChildNode(parent, utf8name.constData());
-        if (child && child->getType() == MegaNode::TYPE_FOLDER)
-        {
-            QDir dir(info.absoluteFilePath());
-            QFileInfoList entries = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot);
-            for (int i = 0; i < entries.size(); i++)
-            {
-                upload(entries[i], child);
-            }
-            delete child;
-            return;
-        }
-        delete child;
+        return QString();
     }
 
-    string localPath = megaApi->getLocalPath(parent);
-    if (localPath.size() && megaApi->isSyncable(utf8name.constData()))
-    {
 #ifdef WIN32
-        QString destPath = QDir::toNativeSeparators(QString::fromWCharArray((const wchar_t *)localPath.data()) + QDir::separator() + fileName);
-        if (destPath.startsWith(QString::fromAscii("\\\\?\\")))
-        {
-            destPath = destPath.mid(4);
-        }
+    QString localFolder = QDir::toNativeSeparators(QString::fromWCharArray((const wchar_t *)localPath.data()));
+    if (localFolder.startsWith(QString::fromAscii("\\\\?\\")))
+    {
+        localFolder = localFolder.mid(4);
+    }
+    return localFolder;
 #else
-        QString destPath = QDir::toNativeSeparators(QString::fromUtf8(localPath.data()) + QDir::separator() + fileName);
+    return QDir::toNativeSeparators(QString::fromUtf8(localPath.data()));
 #endif
-        megaApi->moveToLocalDebris(destPath.toUtf8().constData());
-        QtConcurrent::run(Utilities::copyRecursively, currentPath, destPath);
+}
+
+// Entries uploaded to synced folders are copied to the local folder instead
+bool MegaUploader::copyToLocalFolder(QString sourcePath, QString fileName, QString localFolder)
+{
+    if (localFolder.isEmpty() || !megaApi->isSyncable(fileName.toUtf8().constData()))
+    {
+        return false;
     }
-    else if (info.isFile())
+
+    QString destPath = localFolder + QDir::separator() + fileName;
+    megaApi->moveToLocalDebris(destPath.toUtf8().constData());
+    localCopier->copy(QDir::toNativeSeparators(sourcePath), destPath);
+    return true;
+}
+
+void MegaUploader::cancelLocalCopies()
+{
+    localCopier->cancel();
+}
+
+void MegaUploader::startJob(QString path, QString name, MegaHandle rootParent, MegaNode *existingFolder)
+{
+    int jobId = nextJobId++;
+    UploadJob &job = jobs[jobId];
+    job.rootParent = rootParent;
+    job.scanFinished = false;
+    job.unresolvedFolders = 1;
+
+    UploadFolder root;
+    root.path = path;
+    root.name = name;
+    root.parent = -1;
+    root.state = FOLDER_WAITING;
+    root.handle = INVALID_HANDLE;
+    job.folders.append(root);
+    totalFolders++;
+
+    if (!progressTimer.isActive())
     {
-        megaApi->startUpload(currentPath.toUtf8().constData(), parent);
+        progressTimer.start();
     }
-    else if (info.isDir())
+
+    emit scanFolder(jobId, path);
+    if (existingFolder)
+    {
+        setFolderReady(jobId, 0, FOLDER_EXISTING, existingFolder->getHandle(), localFolderOf(existingFolder));
+    }
+    else
     {
-        folders.enqueue(info);
-        megaApi->createFolder(utf8name.constData(), parent, delegateListener);
+        createFolder(jobId, 0);
     }
+    checkJobFinished(jobId);
 }
 
-void MegaUploader::onRequestFinish(MegaApi *, MegaRequest *request, MegaError *e)
+void MegaUploader::addFolder(int jobId, const UploadFolder &folder)
 {
-    switch(request->getType())
+    UploadJob &job = jobs[jobId];
+    int index = job.folders.size();
+    job.folders.append(folder);
+    job.unresolvedFolders++;
+    totalFolders++;
+
+    UploadFolder &parent = job.folders[folder.parent];
+    switch (parent.state)
     {
-        case MegaRequest::TYPE_CREATE_FOLDER:
-            if (e->getErrorCode() == MegaError::API_OK)
+        case FOLDER_EXISTING:
+        case FOLDER_CREATED:
+            processFolder(jobId, index);
+            break;
+        case FOLDER_SKIPPED:
+            skipFolder(jobId, index);
+            break;
+        default:
+            parent.waitingFolders.append(index);
+            break;
+    }
+}
+
+void MegaUploader::addFile(int jobId, int folder, QString path)
+{
+    UploadFolder &parent = jobs[jobId].folders[folder];
+    switch (parent.state)
+    {
+        case FOLDER_EXISTING:
+        case FOLDER_CREATED:
+        {
+            QString fileName = path.mid(path.lastIndexOf(QChar::fromLatin1('/')) + 1);
+            if (copyToLocalFolder(path, fileName, parent.localFolder))
             {
-                MegaNode *parent = megaApi->getNodeByHandle(request->getNodeHandle());
-                QDir dir(folders.dequeue().absoluteFilePath());
-                QFileInfoList entries = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot);
-                for (int i = 0; i < entries.size(); i++)
-                {
-                    QFileInfo info = entries[i];
-                    if (info.isFile())
-                    {
-                        megaApi->startUpload(QDir::toNativeSeparators(info.absoluteFilePath()).toUtf8().constData(), parent);
-                    }
-                    else if (info.isDir())
-                    {
-                        folders.enqueue(info);
-                        megaApi->createFolder(info.fileName().toUtf8().constData(),
-                                              parent,
-                                              delegateListener);
-                    }
-                }
-                delete parent;
+                processedFiles++;
             }
+            else
+            {
+                queueUpload(path, parent.handle);
+            }
+            break;
+        }
+        case FOLDER_SKIPPED:
+            processedFiles++;
+            break;
+        default:
+            parent.waitingFiles.append(path);
             break;
     }
 }
+
+// Called when the parent of the folder is available in MEGA
+void MegaUploader::processFolder(int jobId, int folder)
+{
+    UploadJob &job = jobs[jobId];
+    const UploadFolder &parent = job.folders.at(job.folders.at(folder).parent);
+    if (parent.state == FOLDER_CREATED)
+    {
+        // new folders are empty, no need to check the children
+        createFolder(jobId, folder);
+        return;
+    }
+
+    MegaNode *parentNode = megaApi->getNodeByHandle(parent.handle);
+    if (!parentNode)
+    {
+        skipFolder(jobId, folder);
+        return;
+    }
+
+    QString name = job.folders.at(folder).name;
+    MegaNode *child = megaApi->getChildNode(parentNode, name.toUtf8().constData());
+    if (child && child->getType() == MegaNode::TYPE_FOLDER)
+    {
+        setFolderReady(jobId, folder, FOLDER_EXISTING, child->getHandle(), localFolderOf(child));
+    }
+    else if (copyToLocalFolder(job.folders.at(folder).path, name, parent.localFolder))
+    {
+        skipFolder(jobId, folder);
+    }
+    else
+    {
+        createFolder(jobId, folder);
+    }
+    delete child;
+    delete parentNode;
+}
+
+void MegaUploader::createFolder(int jobId, int folder)
+{
+    if (activeFolderRequests >= MAX_ACTIVE_FOLDER_REQUESTS)
+    {
+        foldersToCreate.enqueue(qMakePair(jobId, folder));
+        return;
+    }
+
+    UploadJob &job = jobs[jobId];
+    UploadFolder &f = job.folders[folder];
+    MegaHandle parentHandle = (f.parent < 0) ? job.rootParent : job.folders.at(f.parent).handle;
+    MegaNode *parentNode = megaApi->getNodeByHandle(parentHandle);
+    if (!parentNode)
+    {
+        skipFolder(jobId, folder);
+        return;
+    }
+
+    f.state = FOLDER_CREATING;
+    creatingFolders[QString::number(parentHandle) + QString::fromUtf8("/") + f.name].enqueue(qMakePair(jobId, folder));
+    activeFolderRequests++;
+    megaApi->createFolder(f.name.toUtf8().constData(), parentNode, delegateListener);
+    delete parentNode;
+}
+
+void MegaUploader::setFolderReady(int jobId, int folder, int state, MegaHandle handle, QString localFolder)
+{
+    UploadJob &job = jobs[jobId];
+    UploadFolder &f = job.folders[folder];
+    f.state = state;
+    f.handle = handle;
+    f.localFolder = localFolder;
+    job.unresolvedFolders--;
+    resolvedFolders++;
+
+    QStringList files;
+    files.swap(f.waitingFiles);
+    QList<int> folders;
+    folders.swap(f.waitingFolders);
+
+    for (int i = 0; i < files.size(); i++)
+    {
+        addFile(jobId, folder, files.at(i));
+    }
+
+    for (int i = 0; i < folders.size(); i++)
+    {
+        processFolder(jobId, folders.at(i));
+    }
+}
+
+// The folder and its contents won't be uploaded
+void MegaUploader::skipFolder(int jobId, int folder)
+{
+    UploadJob &job = jobs[jobId];
+    UploadFolder &f = job.folders[folder];
+    f.state = FOLDER_SKIPPED;
+    job.unresolvedFolders--;
+    resolvedFolders++;
+
+    processedFiles += f.waitingFiles.size();
+    f.waitingFiles.clear();
+    QList<int> folders;
+    folders.swap(f.waitingFolders);
+    for (int i = 0; i < folders.size(); i++)
+    {
+        skipFolder(jobId, folders.at(i));
+    }
+}
+
+void MegaUploader::queueUpload(QString path, MegaHandle parent)
+{
+    PendingUpload upload;
+    upload.localPath = QDir::toNativeSeparators(path).toUtf8();
+    upload.parent = parent;
+    pendingUploads.enqueue(upload);
+    if (!uploadTimer.isActive())
+    {
+        uploadTimer.start();
+    }
+}
+
+void MegaUploader::checkJobFinished(int jobId)
+{
+    QHash<int, UploadJob>::iterator it = jobs.find(jobId);
+    if (it == jobs.end() || !it.value().scanFinished || it.value().unresolvedFolders)
+    {
+        return;
+    }
+
+    MegaApi::log(MegaApi::LOG_LEVEL_INFO, QString::fromUtf8("Folder upload prepared: %1 (%2 folders)")
+                 .arg(it.value().folders.at(0).path).arg(it.value().folders.size()).toUtf8().constData());
+    jobs.erase(it);
+    checkFinished();
+}
+
+void MegaUploader::checkFinished()
+{
+    if (!jobs.isEmpty() || !pendingUploads.isEmpty() || activeFolderRequests)
+    {
+        return;
+    }
+
+    if (progressTimer.isActive())
+    {
+        progressTimer.stop();
+        emit preparationFinished();
+    }
+
+    scannedItems = 0;
+    resolvedFolders = 0;
+    totalFolders = 0;
+    processedFiles = 0;
+    totalFiles = 0;
+}
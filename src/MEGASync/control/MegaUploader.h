@@ -2,29 +2,165 @@
 #define MEGAUPLOADER_H
 
 #include <QString>
+#include <QStringList>
 #include <QFileInfo>
 #include <QDir>
 #include <QQueue>
+#include <QHash>
+#include <QVector>
+#include <QThread>
+#include <QTimer>
+#include <QMetaType>
+#include <QAtomicInt>
 #include "Preferences.h"
 #include "megaapi.h"
 #include "QTMegaRequestListener.h"
+#include "LocalCopier.h"
 
+// Entries found by the scanner. Folders are sent in breadth-first order, so the parent
+// of a folder is always sent before it. Index 0 is the folder being uploaded.
+struct UploadScanBatch
+{
+    int jobId;
+    QStringList folderPaths;
+    QVector<int> folderParents;
+    QStringList filePaths;
+    QVector<int> fileFolders;
+    bool finished;
+};
+Q_DECLARE_METATYPE(UploadScanBatch)
+
+class FolderScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    FolderScanner();
+    void cancel();
+
+signals:
+    void scanned(UploadScanBatch batch);
+
+public slots:
+    void scan(int jobId, QString path);
+
+protected:
+    QAtomicInt cancelled;
+};
+
+/*
+ * Uploads are prepared in three stages so that transfers can start while big trees
+ * are still being processed:
+ * - a scanner thread lists the local folders
+ * - remote folders are created concurrently as soon as their parent exists
+ * - startUpload is called in batches from the event loop
+ */
 class MegaUploader : public QObject, public mega::MegaRequestListener
 {
     Q_OBJECT
 
 public:
+    enum {
+        STAGE_SCANNING = 0,
+        STAGE_CREATING_FOLDERS,
+        STAGE_STARTING_UPLOADS
+    };
+
     MegaUploader(mega::MegaApi *megaApi);
     virtual ~MegaUploader();
     void upload(QString path, mega::MegaNode *parent);
     virtual void onRequestFinish(mega::MegaApi* api, mega::MegaRequest *request, mega::MegaError* e);
+    void cancelLocalCopies();
+
+signals:
+    void scanFolder(int jobId, QString path);
+    // only the earliest stage that is still running is reported,
+    // total is -1 while it's still unknown
+    void progress(int stage, long long done, long long total);
+    void preparationFinished();
+    // entries uploaded to synced folders are copied there
+    void localCopyProgress(long long copiedBytes, long long totalBytes);
+    void localCopyFinished(bool cancelled);
+
+protected slots:
+    void onFolderScanned(UploadScanBatch batch);
+    void startPendingUploads();
+    void reportProgress();
 
 protected:
-    void upload(QFileInfo info, mega::MegaNode *parent);
+    enum {
+        FOLDER_WAITING = 0,
+        FOLDER_CREATING,
+        FOLDER_EXISTING,
+        FOLDER_CREATED,
+        FOLDER_SKIPPED
+    };
+
+    struct UploadFolder
+    {
+        QString path;
+        QString name;
+        int parent;
+        int state;
+        mega::MegaHandle handle;
+        // set if the folder belongs to a sync, new entries are copied there
+        QString localFolder;
+        QList<int> waitingFolders;
+        QStringList waitingFiles;
+    };
+
+    struct UploadJob
+    {
+        QVector<UploadFolder> folders;
+        mega::MegaHandle rootParent;
+        bool scanFinished;
+        int unresolvedFolders;
+    };
+
+    struct PendingUpload
+    {
+        QByteArray localPath;
+        mega::MegaHandle parent;
+    };
+
+    static QString uploadName(const QFileInfo &info);
+    QString localFolderOf(mega::MegaNode *node);
+    bool copyToLocalFolder(QString sourcePath, QString fileName, QString localFolder);
+    void startJob(QString path, QString name, mega::MegaHandle rootParent, mega::MegaNode *existingFolder);
+    void addFolder(int jobId, const UploadFolder &folder);
+    void addFile(int jobId, int folder, QString path);
+    void processFolder(int jobId, int folder);
+    void createFolder(int jobId, int folder);
+    void setFolderReady(int jobId, int folder, int state, mega::MegaHandle handle, QString localFolder);
+    void skipFolder(int jobId, int folder);
+    void queueUpload(QString path, mega::MegaHandle parent);
+    void checkJobFinished(int jobId);
+    void checkFinished();
 
     mega::MegaApi *megaApi;
     mega::QTMegaRequestListener *delegateListener;
-    QQueue<QFileInfo> folders;
+
+    QThread *scannerThread;
+    FolderScanner *scanner;
+    LocalCopier *localCopier;
+
+    QHash<int, UploadJob> jobs;
+    int nextJobId;
+
+    // createFolder requests in flight, by parent handle and name
+    QHash<QString, QQueue<QPair<int, int> > > creatingFolders;
+    QQueue<QPair<int, int> > foldersToCreate;
+    int activeFolderRequests;
+
+    QQueue<PendingUpload> pendingUploads;
+    QTimer uploadTimer;
+    QTimer progressTimer;
+
+    long long scannedItems;
+    long long resolvedFolders;
+    long long totalFolders;
+    long long processedFiles;
+    long long totalFiles;
 };
 
 #endif // MEGAUPLOADER_H
@@ -0,0 +1,208 @@
+#include "NetworkMonitor.h"
+#include "megaapi.h"
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+// Changes received within this time are reported together,
+// a roaming interface sends several of them in a row
+#define CHANGE_DELAY_MS 100
+// Minimum time between two notifications, each one enumerates all the interfaces
+#define MIN_CHANGE_INTERVAL_MS 2000
+
+using namespace mega;
+
+NetworkMonitor::NetworkMonitor(QObject *parent) : QObject(parent)
+{
+    fd = -1;
+    notifier = NULL;
+    changeTimer.setSingleShot(true);
+    connect(&changeTimer, SIGNAL(timeout()), this, SLOT(onChangeTimeout()));
+}
+
+NetworkMonitor::~NetworkMonitor()
+{
+    stop();
+}
+
+bool NetworkMonitor::start()
+{
+    if (fd >= 0)
+    {
+        return true;
+    }
+
+#ifdef __linux__
+    fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if (fd < 0)
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_WARNING, QString::fromUtf8("Unable to open a netlink socket: %1")
+                     .arg(errno).toUtf8().constData());
+        return false;
+    }
+
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_WARNING, QString::fromUtf8("Unable to bind the netlink socket: %1")
+                     .arg(errno).toUtf8().constData());
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier, SIGNAL(activated(int)), this, SLOT(onNotification()));
+    MegaApi::log(MegaApi::LOG_LEVEL_INFO, "Monitoring network changes with netlink");
+    return true;
+#else
+    return false;
+#endif
+}
+
+void NetworkMonitor::stop()
+{
+    changeTimer.stop();
+    linkFlags.clear();
+    if (notifier)
+    {
+        notifier->setEnabled(false);
+        notifier->deleteLater();
+        notifier = NULL;
+    }
+
+#ifdef __linux__
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+#endif
+    fd = -1;
+}
+
+bool NetworkMonitor::isActive() const
+{
+    return fd >= 0;
+}
+
+void NetworkMonitor::onNotification()
+{
+#ifdef __linux__
+    bool changed = false;
+    char buffer[8192];
+    for (;;)
+    {
+        ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+        if (len < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                break;
+            }
+
+            if (errno == ENOBUFS)
+            {
+                // some notifications were dropped, check everything
+                changed = true;
+                continue;
+            }
+        }
+
+        if (len <= 0)
+        {
+            MegaApi::log(MegaApi::LOG_LEVEL_WARNING, "Netlink socket closed, polling network interfaces");
+            stop();
+            break;
+        }
+
+        int remaining = int(len);
+        for (struct nlmsghdr *header = (struct nlmsghdr *)buffer;
+             NLMSG_OK(header, remaining);
+             header = NLMSG_NEXT(header, remaining))
+        {
+            switch (header->nlmsg_type)
+            {
+                case RTM_NEWLINK:
+                    if (linkStateChanged(header))
+                    {
+                        changed = true;
+                    }
+                    break;
+                case RTM_DELLINK:
+                    if (header->nlmsg_len >= NLMSG_LENGTH(sizeof(struct ifinfomsg)))
+                    {
+                        linkFlags.remove(((struct ifinfomsg *)NLMSG_DATA(header))->ifi_index);
+                    }
+                    changed = true;
+                    break;
+                case RTM_NEWADDR:
+                case RTM_DELADDR:
+                    changed = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    if (changed && !changeTimer.isActive())
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Network change notified by netlink");
+        int delay = CHANGE_DELAY_MS;
+        if (lastChange.isValid())
+        {
+            delay = qMax<qint64>(delay, MIN_CHANGE_INTERVAL_MS - lastChange.elapsed());
+        }
+        changeTimer.start(delay);
+    }
+#endif
+}
+
+void NetworkMonitor::onChangeTimeout()
+{
+    lastChange.start();
+    emit networkChanged();
+}
+
+// Returns true if the message brings up or down an interface, or it's a new one.
+// Wireless drivers send RTM_NEWLINK for scans, statistics and other events
+bool NetworkMonitor::linkStateChanged(void *message)
+{
+#ifdef __linux__
+    struct nlmsghdr *header = (struct nlmsghdr *)message;
+    if (header->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifinfomsg)))
+    {
+        return false;
+    }
+
+    struct ifinfomsg *info = (struct ifinfomsg *)NLMSG_DATA(header);
+    unsigned int flags = info->ifi_flags & (IFF_UP | IFF_RUNNING);
+    QHash<int, unsigned int>::iterator it = linkFlags.find(info->ifi_index);
+    if (it != linkFlags.end() && it.value() == flags)
+    {
+        return false;
+    }
+
+    linkFlags[info->ifi_index] = flags;
+    return true;
+#else
+    Q_UNUSED(message);
+    return false;
+#endif
+}
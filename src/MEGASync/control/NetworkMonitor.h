@@ -0,0 +1,50 @@
+#ifndef NETWORKMONITOR_H
+#define NETWORKMONITOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QSocketNotifier>
+#include <QElapsedTimer>
+#include <QHash>
+
+/*
+ * Notifies changes of the local network interfaces and addresses as soon as they happen.
+ *
+ * On Linux the kernel sends them through a rtnetlink socket. Link messages are only taken
+ * into account when an interface goes up or down, wireless drivers send many more of them.
+ * On other systems, or if the socket can't be opened, start() returns false and the
+ * interfaces must be polled.
+ */
+class NetworkMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    NetworkMonitor(QObject *parent = 0);
+    virtual ~NetworkMonitor();
+
+    bool start();
+    void stop();
+    bool isActive() const;
+
+signals:
+    // emitted once for each burst of changes
+    void networkChanged();
+
+protected slots:
+    void onNotification();
+    void onChangeTimeout();
+
+protected:
+    bool linkStateChanged(void *message);
+
+    int fd;
+    QSocketNotifier *notifier;
+    QTimer changeTimer;
+    // networkChanged() is emitted at most once per MIN_CHANGE_INTERVAL_MS
+    QElapsedTimer lastChange;
+    // IFF_UP and IFF_RUNNING flags of each interface, by index
+    QHash<int, unsigned int> linkFlags;
+};
+
+#endif // NETWORKMONITOR_H
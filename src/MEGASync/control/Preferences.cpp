@@ -28,6 +28,7 @@ const QString Preferences::TRANSLATION_PREFIX = QString::fromAscii("MEGASyncStri
 
 const int Preferences::STATE_REFRESH_INTERVAL_MS        = 10000;
 const int Preferences::FINISHED_TRANSFER_REFRESH_INTERVAL_MS        = 10000;
+const int Preferences::GLOBAL_STATE_UPDATE_INTERVAL_MS              = 50;
 
 const long long Preferences::MIN_UPDATE_STATS_INTERVAL  = 300000;
 const long long Preferences::MIN_UPDATE_STATS_INTERVAL_OVERQUOTA    = 30000;
@@ -43,6 +44,12 @@ const unsigned int Preferences::PROXY_TEST_TIMEOUT_MS               = 10000;
 const unsigned int Preferences::LOCAL_HTTPS_TEST_TIMEOUT_MS         = 10000;
 const unsigned int Preferences::MAX_IDLE_TIME_MS                    = 600000;
 const unsigned int Preferences::MAX_COMPLETED_ITEMS                 = 1000;
+const unsigned int Preferences::MAX_TRANSFER_REFRESH_RATE           = 30;
+const long long Preferences::MAX_LOG_FILE_SIZE                      = 50 * 1024 * 1024;
+const int Preferences::MAX_ROTATED_LOG_FILES                        = 5;
+const int Preferences::MAX_PENDING_LOG_LINES                        = 100000;
+const int Preferences::MAX_LOCAL_COPY_THREADS                       = 4;
+const int Preferences::MAX_DIRECTORY_STATS_THREADS                  = 4;
 
 const qint16 Preferences::HTTPS_PORT = 6342;
 
@@ -230,6 +237,7 @@ const QString Preferences::localPathKey             = QString::fromAscii("localP
 const QString Preferences::localFingerprintKey      = QString::fromAscii("localFingerprint");
 const QString Preferences::fileTimeKey              = QString::fromAscii("fileTime");
 const QString Preferences::isCrashedKey             = QString::fromAscii("isCrashed");
+const QString Preferences::cacheCheckNeededKey      = QString::fromAscii("cacheCheckNeeded");
 const QString Preferences::wasPausedKey             = QString::fromAscii("wasPaused");
 const QString Preferences::wasUploadsPausedKey      = QString::fromAscii("wasUploadsPaused");
 const QString Preferences::wasDownloadsPausedKey    = QString::fromAscii("wasDownloadsPaused");
@@ -383,6 +391,8 @@ void Preferences::initialize(QString dataPath)
 Preferences::Preferences() : QObject(), mutex(QMutex::Recursive)
 {
     diffTimeWithSDK = 0;
+    activeSyncRootsValid = false;
+    folderWatcher = NULL;
     clearTemporalBandwidth();
 }
 
@@ -1659,17 +1669,104 @@ QString Preferences::getLocalFolder(int num)
         return QString();
     }
 
-    QFileInfo fileInfo(localFolders.at(num));
-    QString value = QDir::toNativeSeparators(fileInfo.canonicalFilePath());
+    if (canonicalLocalFolders.size() != localFolders.size())
+    {
+        canonicalLocalFolders.clear();
+        for (int i = 0; i < localFolders.size(); i++)
+        {
+            canonicalLocalFolders.append(QString());
+        }
+    }
+
+    QString value = canonicalLocalFolders.at(num);
     if (value.isEmpty())
     {
-        value = QDir::toNativeSeparators(localFolders.at(num));
+        value = canonicalLocalFolder(localFolders.at(num));
+        canonicalLocalFolders[num] = value;
     }
 
     mutex.unlock();
     return value;
 }
 
+void Preferences::localFoldersChanged()
+{
+    canonicalLocalFolders.clear();
+    // the watcher belongs to the thread of this object
+    QMetaObject::invokeMethod(this, "refreshFolderWatcher", Qt::QueuedConnection);
+}
+
+void Preferences::refreshFolderWatcher()
+{
+    mutex.lock();
+    QStringList parents;
+    for (int i = 0; i < localFolders.size(); i++)
+    {
+        QString parent = QFileInfo(localFolders.at(i)).absolutePath();
+        if (!parents.contains(parent))
+        {
+            parents.append(parent);
+        }
+    }
+    mutex.unlock();
+
+    if (!folderWatcher)
+    {
+        folderWatcher = new QFileSystemWatcher(this);
+        connect(folderWatcher, SIGNAL(directoryChanged(QString)), this, SLOT(onFolderParentChanged(QString)));
+    }
+
+    QStringList watched = folderWatcher->directories();
+    for (int i = 0; i < watched.size(); i++)
+    {
+        if (!parents.contains(watched.at(i)))
+        {
+            folderWatcher->removePath(watched.at(i));
+        }
+    }
+
+    for (int i = 0; i < parents.size(); i++)
+    {
+        if (!watched.contains(parents.at(i)) && QFileInfo(parents.at(i)).isDir())
+        {
+            folderWatcher->addPath(parents.at(i));
+        }
+    }
+}
+
+// a local folder could have been renamed, moved or replaced by a link.
+// Parents like the home folder change often, so only the folders inside
+// the changed one are resolved again
+void Preferences::onFolderParentChanged(QString path)
+{
+    mutex.lock();
+    for (int i = 0; i < canonicalLocalFolders.size() && i < localFolders.size(); i++)
+    {
+        QString cached = canonicalLocalFolders.at(i);
+        if (cached.isEmpty() || QFileInfo(localFolders.at(i)).absolutePath() != path)
+        {
+            continue;
+        }
+
+        QString value = canonicalLocalFolder(localFolders.at(i));
+        if (value != cached)
+        {
+            canonicalLocalFolders[i] = value;
+        }
+    }
+    mutex.unlock();
+}
+
+QString Preferences::canonicalLocalFolder(const QString &path)
+{
+    QString value = QDir::toNativeSeparators(QFileInfo(path).canonicalFilePath());
+    if (value.isEmpty())
+    {
+        value = QDir::toNativeSeparators(path);
+    }
+    return value;
+}
+
 QString Preferences::getMegaFolder(int num)
 {
     mutex.lock();
@@ -1725,6 +1822,28 @@ MegaHandle Preferences::getMegaFolderHandle(int num)
     return value;
 }
 
+QMultiHash<MegaHandle, int> Preferences::getActiveSyncRoots()
+{
+    mutex.lock();
+    if (!activeSyncRootsValid)
+    {
+        activeSyncRoots.clear();
+        for (int i = 0; i < megaFolderHandles.size() && i < activeFolders.size(); i++)
+        {
+            if (activeFolders.at(i))
+            {
+                activeSyncRoots.insert(megaFolderHandles.at(i), i);
+            }
+        }
+        activeSyncRootsValid = true;
+    }
+
+    // implicitly shared, the copy is cheap and can be read from any thread
+    QMultiHash<MegaHandle, int> value = activeSyncRoots;
+    mutex.unlock();
+    return value;
+}
+
 bool Preferences::isFolderActive(int num)
 {
     mutex.lock();
@@ -1761,6 +1880,7 @@ void Preferences::setSyncState(int num, bool enabled, bool temporaryDisabled)
     }
     activeFolders[num] = enabled;
     temporaryInactiveFolders[num] = temporaryDisabled;
+    activeSyncRootsValid = false;
     writeFolders();
     mutex.unlock();
 
@@ -1873,10 +1993,12 @@ void Preferences::addSyncedFolder(QString localFolder, QString megaFolder, mega:
     QString syncID = QUuid::createUuid().toString().toUpper();
     syncIDs.append(syncID);
     localFolders.append(localFolder);
+    localFoldersChanged();
     megaFolders.append(megaFolder);
     megaFolderHandles.append(megaFolderHandle);
     activeFolders.append(active);
     temporaryInactiveFolders.append(false);
+    activeSyncRootsValid = false;
     localFingerprints.append(0);
     writeFolders();
     mutex.unlock();
@@ -1892,6 +2014,7 @@ void Preferences::setMegaFolderHandle(int num, MegaHandle handle)
         return;
     }
     megaFolderHandles[num] = handle;
+    activeSyncRootsValid = false;
     writeFolders();
     mutex.unlock();
 }
@@ -1903,10 +2026,12 @@ void Preferences::removeSyncedFolder(int num)
     syncNames.removeAt(num);
     syncIDs.removeAt(num);
     localFolders.removeAt(num);
+    localFoldersChanged();
     megaFolders.removeAt(num);
     megaFolderHandles.removeAt(num);
     activeFolders.removeAt(num);
     temporaryInactiveFolders.removeAt(num);
+    activeSyncRootsValid = false;
     localFingerprints.removeAt(num);
     writeFolders();
     mutex.unlock();
@@ -1925,10 +2050,12 @@ void Preferences::removeAllFolders()
     syncNames.clear();
     syncIDs.clear();
     localFolders.clear();
+    localFoldersChanged();
     megaFolders.clear();
     megaFolderHandles.clear();
     activeFolders.clear();
     temporaryInactiveFolders.clear();
+    activeSyncRootsValid = false;
     localFingerprints.clear();
     writeFolders();
     mutex.unlock();
@@ -2047,7 +2174,7 @@ void Preferences::setLastReboot(long long value)
         settings->beginGroup(currentAccount);
     }
 
-    settings->sync();
+    settings->flush();
     mutex.unlock();
 }
 
@@ -2131,6 +2258,7 @@ void Preferences::setHttpsKey(QString key)
     }
 
     settings->sync();
+    emit httpsCertificateChanged();
 }
 
 QString Preferences::getHttpsCert()
@@ -2171,6 +2299,7 @@ void Preferences::setHttpsCert(QString cert)
     }
 
     settings->sync();
+    emit httpsCertificateChanged();
 }
 
 QString Preferences::getHttpsCertIntermediate()
@@ -2211,6 +2340,7 @@ void Preferences::setHttpsCertIntermediate(QString intermediate)
     }
 
     settings->sync();
+    emit httpsCertificateChanged();
 }
 
 long long Preferences::getHttpsCertExpiration()
@@ -2287,10 +2417,12 @@ void Preferences::leaveUser()
     syncNames.clear();
     syncIDs.clear();
     localFolders.clear();
+    localFoldersChanged();
     megaFolders.clear();
     megaFolderHandles.clear();
     activeFolders.clear();
     temporaryInactiveFolders.clear();
+    activeSyncRootsValid = false;
     localFingerprints.clear();
     mutex.unlock();
 }
@@ -2309,10 +2441,12 @@ void Preferences::unlink()
     syncNames.clear();
     syncIDs.clear();
     localFolders.clear();
+    localFoldersChanged();
     megaFolders.clear();
     megaFolderHandles.clear();
     activeFolders.clear();
     temporaryInactiveFolders.clear();
+    activeSyncRootsValid = false;
     localFingerprints.clear();
     settings->sync();
     mutex.unlock();
@@ -2331,7 +2465,24 @@ void Preferences::setCrashed(bool value)
 {
     mutex.lock();
     settings->setValue(isCrashedKey, value);
-    settings->sync();
+    // read by the next instance, it can't wait for the sync timer
+    settings->flush();
+    mutex.unlock();
+}
+
+bool Preferences::isCacheCheckNeeded()
+{
+    mutex.lock();
+    bool value = settings->value(cacheCheckNeededKey, false).toBool();
+    mutex.unlock();
+    return value;
+}
+
+void Preferences::setCacheCheckNeeded(bool value)
+{
+    mutex.lock();
+    settings->setValue(cacheCheckNeededKey, value);
+    settings->flush();
     mutex.unlock();
 }
 
@@ -2469,6 +2620,13 @@ void Preferences::sync()
     settings->sync();
 }
 
+void Preferences::flush()
+{
+    mutex.lock();
+    settings->flush();
+    mutex.unlock();
+}
+
 void Preferences::login(QString account)
 {
     mutex.lock();
@@ -2529,10 +2687,12 @@ void Preferences::logout()
     syncNames.clear();
     syncIDs.clear();
     localFolders.clear();
+    localFoldersChanged();
     megaFolders.clear();
     megaFolderHandles.clear();
     activeFolders.clear();
     temporaryInactiveFolders.clear();
+    activeSyncRootsValid = false;
     localFingerprints.clear();
     mutex.unlock();
 }
@@ -2581,10 +2741,12 @@ void Preferences::readFolders()
     syncNames.clear();
     syncIDs.clear();
     localFolders.clear();
+    localFoldersChanged();
     megaFolders.clear();
     megaFolderHandles.clear();
     activeFolders.clear();
     temporaryInactiveFolders.clear();
+    activeSyncRootsValid = false;
     localFingerprints.clear();
 
     settings->beginGroup(syncsGroupKey);
@@ -6,6 +6,8 @@
 #include <QLocale>
 #include <QStringList>
 #include <QMutex>
+#include <QMultiHash>
+#include <QFileSystemWatcher>
 
 #include "control/EncryptedSettings.h"
 #include "megaapi.h"
@@ -19,6 +21,11 @@ class Preferences : public QObject
 signals:
     void stateChanged();
     void updated(int lastVersion);
+    void httpsCertificateChanged();
+
+private slots:
+    void refreshFolderWatcher();
+    void onFolderParentChanged(QString path);
 
 private:
     static Preferences *preferences;
@@ -194,6 +201,8 @@ public:
     void setLocalFingerprint(int num, long long fingerprint);
     mega::MegaHandle getMegaFolderHandle(int num);
     bool isFolderActive(int num);
+    // remote folder of each active sync -> index of the sync, rebuilt only when the syncs change
+    QMultiHash<mega::MegaHandle, int> getActiveSyncRoots();
     bool isTemporaryInactiveFolder(int num);
     void setSyncState(int num, bool enabled, bool temporaryDisabled = false);
 
@@ -237,6 +246,9 @@ public:
 
     bool isCrashed();
     void setCrashed(bool value);
+    // set after an unexpected exit, the local caches are verified instead of discarded
+    bool isCacheCheckNeeded();
+    void setCacheCheckNeeded(bool value);
     bool getGlobalPaused();
     void setGlobalPaused(bool value);
     bool getUploadsPaused();
@@ -257,6 +269,8 @@ public:
     void clearTemporalBandwidth();
     void clearAll();
     void sync();
+    // writes the pending changes to disk before returning
+    void flush();
 
     enum {
         PROXY_TYPE_NONE = 0,
@@ -295,6 +309,7 @@ public:
     static const long long MIN_UPDATE_STATS_INTERVAL_OVERQUOTA;
     static const int STATE_REFRESH_INTERVAL_MS;
     static const int FINISHED_TRANSFER_REFRESH_INTERVAL_MS;
+    static const int GLOBAL_STATE_UPDATE_INTERVAL_MS;
     static const long long MIN_UPDATE_NOTIFICATION_INTERVAL_MS;
     static const unsigned int UPDATE_INITIAL_DELAY_SECS;
     static const unsigned int UPDATE_RETRY_INTERVAL_SECS;
@@ -330,6 +345,12 @@ public:
     static QStringList HTTPS_ALLOWED_ORIGINS;
     static bool HTTPS_ORIGIN_CHECK_ENABLED;
     static const unsigned int MAX_COMPLETED_ITEMS;
+    static const unsigned int MAX_TRANSFER_REFRESH_RATE;
+    static const long long MAX_LOG_FILE_SIZE;
+    static const int MAX_ROTATED_LOG_FILES;
+    static const int MAX_PENDING_LOG_LINES;
+    static const int MAX_LOCAL_COPY_THREADS;
+    static const int MAX_DIRECTORY_STATS_THREADS;
 
 protected:
     QMutex mutex;
@@ -349,6 +370,14 @@ protected:
     QList<long long> localFingerprints;
     QList<bool> activeFolders;
     QList<bool> temporaryInactiveFolders;
+    QMultiHash<mega::MegaHandle, int> activeSyncRoots;
+    bool activeSyncRootsValid;
+    // canonical paths of localFolders, resolved on demand (empty if not resolved yet)
+    QStringList canonicalLocalFolders;
+    // the parents of the local folders are watched to detect renames
+    QFileSystemWatcher *folderWatcher;
+    void localFoldersChanged();
+    static QString canonicalLocalFolder(const QString &path);
     QStringList excludedSyncNames;
     bool errorFlag;
     long long tempBandwidth;
@@ -425,6 +454,7 @@ protected:
     static const QString excludedSyncNamesKey;
     static const QString lastVersionKey;
     static const QString isCrashedKey;
+    static const QString cacheCheckNeededKey;
     static const QString lastStatsRequestKey;
     static const QString wasPausedKey;
     static const QString wasUploadsPausedKey;
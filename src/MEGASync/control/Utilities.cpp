@@ -1,5 +1,7 @@
 #include "Utilities.h"
 #include "control/Preferences.h"
+#include "control/LocalCopier.h"
+#include "control/DirectoryStats.h"
 
 #include <QApplication>
 #include <QImageReader>
@@ -11,7 +13,6 @@
 
 #ifndef WIN32
 #include "megaapi.h"
-#include <utime.h>
 #endif
 
 using namespace std;
@@ -156,50 +157,6 @@ void Utilities::initializeExtensions()
                             extensionIcons[QString::fromAscii("wps")] = QString::fromAscii("word.png");
 }
 
-void Utilities::countFilesAndFolders(QString path, long *numFiles, long *numFolders, long fileLimit, long folderLimit)
-{
-    if (!path.size())
-    {
-        return;
-    }
-
-    QApplication::processEvents();
-
-#ifdef WIN32
-    if (path.startsWith(QString::fromAscii("\\\\?\\")))
-    {
-        path = path.mid(4);
-    }
-#endif
-
-    QFileInfo baseDir(path);
-    if (!baseDir.exists() || !baseDir.isDir())
-    {
-        return;
-    }
-
-    if ((((*numFolders) > folderLimit)) || (((*numFiles) > fileLimit)))
-    {
-        return;
-    }
-
-    QDir dir(path);
-    QFileInfoList entries = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot);
-    for (int i = 0; i < entries.size(); i++)
-    {
-        QFileInfo info = entries[i];
-        if (info.isFile())
-        {
-            (*numFiles)++;
-        }
-        else if (info.isDir())
-        {
-            countFilesAndFolders(info.absoluteFilePath(), numFiles, numFolders, fileLimit, folderLimit);
-            (*numFolders)++;
-        }
-    }
-}
-
 void Utilities::getFolderSize(QString folderPath, long long *size)
 {
     if (!folderPath.size())
@@ -207,20 +164,7 @@ void Utilities::getFolderSize(QString folderPath, long long *size)
         return;
     }
 
-    QDir dir(folderPath);
-    QFileInfoList entries = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden);
-    for (int i = 0; i < entries.size(); i++)
-    {
-        QFileInfo info = entries[i];
-        if (info.isFile())
-        {
-            (*size) += info.size();
-        }
-        else if (info.isDir())
-        {
-            getFolderSize(info.absoluteFilePath(), size);
-        }
-    }
+    (*size) += DirectoryStats::instance()->stats(folderPath).size;
 }
 
 qreal Utilities::getDevicePixelRatio()
@@ -361,14 +305,7 @@ void Utilities::copyRecursively(QString srcPath, QString dstPath)
 
     if (source.isFile())
     {
-        QFile src(srcPath);
-        src.copy(dstPath);
-#ifndef _WIN32
-       QFileInfo info(src);
-       time_t t = info.lastModified().toTime_t();
-       struct utimbuf times = { t, t };
-       utime(dstPath.toUtf8().constData(), &times);
-#endif
+        LocalCopier::copyFile(srcPath, dstPath);
     }
     else if (source.isDir())
     {
@@ -21,7 +21,6 @@ private:
     static QHash<QString, QString> extensionIcons;
     static QHash<QString, QString> languageNames;
     static void initializeExtensions();
-    static void countFilesAndFolders(QString path, long *numFiles, long *numFolders, long fileLimit, long folderLimit);
     static QString getExtensionPixmap(QString fileName, QString prefix);
 
 //Platform dependent functions
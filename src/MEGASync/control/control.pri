@@ -3,6 +3,14 @@ INCLUDEPATH += $$PWD
 
 QT       += network
 
+# LogFileWriter compresses the rotated log files with zlib
+win32 {
+    INCLUDEPATH += $$[QT_INSTALL_PREFIX]/src/3rdparty/zlib
+}
+unix {
+    LIBS += -lz
+}
+
 SOURCES += $$PWD/HTTPServer.cpp \
     $$PWD/Preferences.cpp \
     $$PWD/LinkProcessor.cpp \
@@ -14,6 +22,12 @@ SOURCES += $$PWD/HTTPServer.cpp \
     $$PWD/Utilities.cpp \
     $$PWD/MegaDownloader.cpp \
     $$PWD/MegaSyncLogger.cpp \
+    $$PWD/LogFileWriter.cpp \
+    $$PWD/LocalCopier.cpp \
+    $$PWD/DirectoryStats.cpp \
+    $$PWD/LocalCacheChecker.cpp \
+    $$PWD/NetworkMonitor.cpp \
+    $$PWD/ExternalDownloadParser.cpp \
     $$PWD/ConnectivityChecker.cpp
 
 HEADERS  +=  $$PWD/HTTPServer.h \
@@ -27,5 +41,11 @@ HEADERS  +=  $$PWD/HTTPServer.h \
     $$PWD/Utilities.h \
     $$PWD/MegaDownloader.h \
     $$PWD/MegaSyncLogger.h \
+    $$PWD/LogFileWriter.h \
+    $$PWD/LocalCopier.h \
+    $$PWD/DirectoryStats.h \
+    $$PWD/LocalCacheChecker.h \
+    $$PWD/NetworkMonitor.h \
+    $$PWD/ExternalDownloadParser.h \
     $$PWD/ConnectivityChecker.h
 
@@ -946,6 +946,7 @@ void InfoDialog::uploadState()
 void InfoDialog::cancelAllUploads()
 {
     megaApi->cancelTransfers(MegaTransfer::TYPE_UPLOAD);
+    app->cancelLocalCopies();
 }
 
 void InfoDialog::cancelAllDownloads()
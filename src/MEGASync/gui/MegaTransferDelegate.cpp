@@ -2,6 +2,9 @@
 #include <QPainter>
 #include <QEvent>
 #include <QMouseEvent>
+#include <QHelpEvent>
+#include <QToolTip>
+#include <QAbstractItemView>
 #include <QMessageBox>
 #include "control/Utilities.h"
 #include "Preferences.h"
@@ -16,6 +19,9 @@ MegaTransferDelegate::MegaTransferDelegate(QTransfersModel *model, QObject *pare
     : QStyledItemDelegate(parent)
 {
     this->model = model;
+    this->hoveredTag = 0;
+    rowPainter = new TransferRowPainter(this);
+    connect(rowPainter, SIGNAL(animationFrameChanged()), this, SIGNAL(animationFrameChanged()));
 }
 
 void MegaTransferDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
@@ -28,65 +34,22 @@ void MegaTransferDelegate::paint(QPainter *painter, const QStyleOptionViewItem &
         }
 
         int tag = index.internalId();
-        int modelType = model->getModelType();
-        TransferItem *ti = model->transferItems[tag];
-        if (!ti)
+        TransferRowData *rowData = model->getRowData(tag);
+        if (!rowData)
         {
-            ti = new TransferItem();
-            ti->setTransferTag(tag);
-            connect(ti, SIGNAL(refreshTransfer(int)), model, SLOT(refreshTransferItem(int)));
-            model->transferItems.insert(tag, ti);
-            MegaTransfer *transfer = model->getTransferByTag(tag);
-
-            if (transfer)
-            {
-                ti->setType(transfer->getType(), transfer->isSyncTransfer());
-                ti->setFileName(QString::fromUtf8(transfer->getFileName()));
-                ti->setTotalSize(transfer->getTotalBytes());
-                ti->setSpeed(transfer->getSpeed(), transfer->getMeanSpeed());
-                ti->setTransferredBytes(transfer->getTransferredBytes(), !transfer->isSyncTransfer());
-                ti->setTransferState(transfer->getState());
-                ti->setPriority(transfer->getPriority());
-                if (modelType == QTransfersModel::TYPE_FINISHED)
-                {
-                    ti->setFinishedTime(transfer->getUpdateTime());
-                }
-                else
-                {
-                    delete transfer;
-                }
-            }
-        }
-        else if (modelType != QTransfersModel::TYPE_FINISHED)
-        {
-            ti->updateTransfer();
+            return;
         }
 
-        if (modelType == QTransfersModel::TYPE_FINISHED)
-        {
-            ti->updateFinishedTime();
-        }
-        else
+        bool paused = false;
+        int modelType = model->getModelType();
+        if (modelType != QTransfersModel::TYPE_FINISHED)
         {
             Preferences *preferences = Preferences::instance();
-            if ((modelType == QTransfersModel::TYPE_DOWNLOAD) &&
-                (preferences->getDownloadsPaused()))
-            {
-                ti->setStateLabel(tr("paused"));
-                ti->loadDefaultTransferIcon();
-            }
-            else if ((modelType == QTransfersModel::TYPE_UPLOAD) &&
-                (preferences->getUploadsPaused()))
-            {
-                ti->setStateLabel(tr("paused"));
-                ti->loadDefaultTransferIcon();
-            }
+            paused = (modelType == QTransfersModel::TYPE_DOWNLOAD && preferences->getDownloadsPaused())
+                    || (modelType == QTransfersModel::TYPE_UPLOAD && preferences->getUploadsPaused());
         }
 
-        painter->save();
-        painter->translate(option.rect.topLeft());
-        ti->render(painter, QPoint(0, 0), QRegion(0, 0, option.rect.width(), option.rect.height()));
-        painter->restore();
+        rowPainter->paint(painter, option.rect, *rowData, paused, tag == hoveredTag);
     }
     else
     {
@@ -111,13 +74,13 @@ bool MegaTransferDelegate::editorEvent(QEvent *event, QAbstractItemModel *, cons
     if (QEvent::MouseButtonRelease ==  event->type())
     {
         int tag = index.internalId();
-        TransferItem *item = model->transferItems[tag];
-        if (!item)
+        TransferRowData *rowData = model->getRowData(tag);
+        if (!rowData || tag != hoveredTag)
         {
             return true;
         }
 
-        if (item->cancelButtonClicked(((QMouseEvent *)event)->pos() - option.rect.topLeft()))
+        if (rowPainter->cancelButtonClicked(option.rect, *rowData, ((QMouseEvent *)event)->pos()))
         {
             if (model->getModelType() == QTransfersModel::TYPE_FINISHED)
             {
@@ -145,3 +108,31 @@ bool MegaTransferDelegate::editorEvent(QEvent *event, QAbstractItemModel *, cons
 
     return QAbstractItemDelegate::editorEvent(event, model, option, index);;
 }
+
+bool MegaTransferDelegate::helpEvent(QHelpEvent *event, QAbstractItemView *view, const QStyleOptionViewItem &option, const QModelIndex &index)
+{
+    if (event->type() == QEvent::ToolTip && index.isValid())
+    {
+        TransferRowData *rowData = model->getRowData(index.internalId());
+        if (rowData && rowPainter->nameRect(option.rect, *rowData).contains(event->pos()))
+        {
+            QToolTip::showText(event->globalPos(), rowData->fileName, view);
+            return true;
+        }
+
+        QToolTip::hideText();
+        return true;
+    }
+
+    return QStyledItemDelegate::helpEvent(event, view, option, index);
+}
+
+void MegaTransferDelegate::setHoveredTag(int tag)
+{
+    hoveredTag = tag;
+}
+
+int MegaTransferDelegate::getHoveredTag() const
+{
+    return hoveredTag;
+}
@@ -2,7 +2,7 @@
 #define MEGATRANSFERDELEGATE_H
 
 #include <QStyledItemDelegate>
-#include "TransferItem.h"
+#include "TransferRowPainter.h"
 #include "QTransfersModel.h"
 
 class MegaTransferDelegate : public QStyledItemDelegate
@@ -15,8 +15,20 @@ public:
     QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const;
     bool editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option, const QModelIndex &index);
 
+    void setHoveredTag(int tag);
+    int getHoveredTag() const;
+
+public slots:
+    // a slot, Qt4 views invoke it by name
+    bool helpEvent(QHelpEvent *event, QAbstractItemView *view, const QStyleOptionViewItem &option, const QModelIndex &index);
+
+signals:
+    void animationFrameChanged();
+
 protected:
     QTransfersModel *model;
+    TransferRowPainter *rowPainter;
+    int hoveredTag;
 };
 
 #endif // MEGATRANSFERDELEGATE_H
@@ -1,4 +1,5 @@
 #include "MegaTransferView.h"
+#include "MegaTransferDelegate.h"
 #include "MegaApplication.h"
 #include "platform/Platform.h"
 #include "control/Utilities.h"
@@ -278,66 +279,31 @@ void MegaTransferView::mouseMoveEvent(QMouseEvent *event)
     if (model)
     {
         QModelIndex index = indexAt(event->pos());
-        if (index.isValid())
-        {
-            int tag = index.internalId();
-            if (tag != lastItemHoveredTag)
-            {
-                if (lastItemHoveredTag)
-                {
-                    TransferItem *lastItemHovered = model->transferItems[lastItemHoveredTag];
-                    if (lastItemHovered)
-                    {
-                        lastItemHovered->mouseHoverTransfer(false);
-                    }
-                }
-
-                TransferItem *item = model->transferItems[tag];
-                if (item)
-                {
-                    lastItemHoveredTag = item->getTransferTag();
-                    item->mouseHoverTransfer(true);
-                }
-                else
-                {
-                    lastItemHoveredTag = 0;
-                }
-            }
-        }
-        else
-        {
-            if (lastItemHoveredTag)
-            {
-                TransferItem *lastItemHovered = model->transferItems[lastItemHoveredTag];
-                if (lastItemHovered)
-                {
-                    lastItemHovered->mouseHoverTransfer(false);
-                    update();
-                }
-                lastItemHoveredTag = 0;
-            }
-        }
+        setHoveredTag(index.isValid() ? index.internalId() : 0);
     }
     QTreeView::mouseMoveEvent(event);
 }
 
 void MegaTransferView::leaveEvent(QEvent *event)
 {
-    QTransfersModel *model = (QTransfersModel*)this->model();
-    if (model)
+    setHoveredTag(0);
+    QTreeView::leaveEvent(event);
+}
+
+void MegaTransferView::setHoveredTag(int tag)
+{
+    if (tag == lastItemHoveredTag)
     {
-        if (lastItemHoveredTag)
-        {
-            TransferItem *lastItemHovered = model->transferItems[lastItemHoveredTag];
-            if (lastItemHovered)
-            {
-                lastItemHovered->mouseHoverTransfer(false);
-                update();
-            }
-            lastItemHoveredTag = 0;
-        }
+        return;
     }
-    QTreeView::leaveEvent(event);
+
+    lastItemHoveredTag = tag;
+    MegaTransferDelegate *delegate = (MegaTransferDelegate *)itemDelegate();
+    if (delegate)
+    {
+        delegate->setHoveredTag(tag);
+    }
+    viewport()->update();
 }
 
 void MegaTransferView::changeEvent(QEvent *event)
@@ -376,7 +342,7 @@ void MegaTransferView::onCustomContextMenu(const QPoint &point)
             transferTagSelected.append(indexes[i].internalId());
             if (!enablePause || !enableResume || !enableCancel)
             {
-                TransferItem *item = model->transferItems[indexes[i].internalId()];
+                TransferRowData *item = model->getRowData(indexes[i].internalId());
                 if (!item)
                 {
                     enableResume = true;
@@ -385,12 +351,12 @@ void MegaTransferView::onCustomContextMenu(const QPoint &point)
                 }
                 else
                 {
-                    if (item->getRegular())
+                    if (item->cancellable)
                     {
                         enableCancel = true;
                     }
 
-                    if (item->getTransferState() == mega::MegaTransfer::STATE_PAUSED)
+                    if (item->state == mega::MegaTransfer::STATE_PAUSED)
                     {
                         enableResume = true;
                     }
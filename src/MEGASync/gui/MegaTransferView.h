@@ -4,7 +4,6 @@
 #include <QTreeView>
 #include <QMenu>
 #include <QMouseEvent>
-#include "TransferItem.h"
 #include "QTransfersModel.h"
 
 class MegaTransferView : public QTreeView
@@ -39,6 +38,7 @@ private:
     QAction *clearAllCompleted;
 
     void createContextMenu();
+    void setHoveredTag(int tag);
     void createCompletedContextMenu();
     void customizeContextInProgressMenu(bool enablePause, bool enableResume, bool enableUpMoves, bool enableDownMoves, bool isCancellable);
     void customizeCompletedContextMenu(bool enableGetLink = true, bool enableOpen = true, bool enableShow = true);
@@ -18,6 +18,10 @@ bool priority_comparator(TransferItemData* i, TransferItemData *j)
 QActiveTransfersModel::QActiveTransfersModel(int type, MegaTransferData *transferData, QObject *parent) :
     QTransfersModel(type, parent)
 {
+    refreshTimer.setSingleShot(true);
+    setMaxRefreshRate(Preferences::MAX_TRANSFER_REFRESH_RATE);
+    connect(&refreshTimer, SIGNAL(timeout()), this, SLOT(flushPendingUpdates()));
+
     if (!transferData)
     {
         return;
@@ -66,6 +70,18 @@ QActiveTransfersModel::QActiveTransfersModel(int type, MegaTransferData *transfe
         assert(false);
         megaApi->sendEvent(99513, QString::fromUtf8("Duplicated active transfer during initialization").toUtf8().constData());
     }
+
+    // Snapshots of transfers started before the model was created.
+    // The rest are filled from the transfer callbacks.
+    for (QMap<int, TransferItemData*>::iterator it = transfers.begin(); it != transfers.end(); ++it)
+    {
+        MegaTransfer *transfer = megaApi->getTransferByTag(it.key());
+        if (transfer)
+        {
+            updateRowData(transfer);
+            delete transfer;
+        }
+    }
 }
 
 void QActiveTransfersModel::removeTransferByTag(int transferTag)
@@ -87,7 +103,9 @@ void QActiveTransfersModel::removeTransferByTag(int transferTag)
     beginRemoveRows(QModelIndex(), row, row);
     transfers.remove(transferTag);
     transferOrder.erase(it);
-    transferItems.remove(transferTag);
+    transferRows.remove(transferTag);
+    dirtyTags.remove(transferTag);
+    pendingPriorities.remove(transferTag);
     endRemoveRows();
     delete item;
 
@@ -186,6 +204,11 @@ MegaTransfer *QActiveTransfersModel::getTransferByTag(int tag)
     return megaApi->getTransferByTag(tag);
 }
 
+void QActiveTransfersModel::setMaxRefreshRate(int refreshesPerSecond)
+{
+    refreshTimer.setInterval(refreshesPerSecond > 0 ? 1000 / refreshesPerSecond : 0);
+}
+
 void QActiveTransfersModel::onTransferStart(MegaApi *, MegaTransfer *transfer)
 {
     if (transfer->getType() == type)
@@ -207,6 +230,7 @@ void QActiveTransfersModel::onTransferStart(MegaApi *, MegaTransfer *transfer)
         beginInsertRows(QModelIndex(), row, row);
         transfers.insert(item->tag, item);
         transferOrder.insert(it, item);
+        updateRowData(transfer);
         endInsertRows();
 
         if (transferOrder.size() == 1)
@@ -249,84 +273,157 @@ void QActiveTransfersModel::updateTransferInfo(MegaTransfer *transfer)
     }
 
     unsigned long long newPriority = transfer->getPriority();
-    TransferItem *item = transferItems[transfer->getTag()];
-    if (item)
+    updateRowData(transfer);
+
+    // Row updates and moves are batched and applied in flushPendingUpdates
+    if (newPriority == itemData->priority)
     {
-        if (item->getType() < 0)
-        {
-            item->setType(transfer->getType(), transfer->isSyncTransfer());
-            item->setFileName(QString::fromUtf8(transfer->getFileName()));
-            item->setTotalSize(transfer->getTotalBytes());
-        }
+        pendingPriorities.remove(itemData->tag);
+    }
+    else
+    {
+        pendingPriorities.insert(itemData->tag, newPriority);
+    }
+    dirtyTags.insert(itemData->tag);
+    scheduleRefresh();
+}
+
+void QActiveTransfersModel::scheduleRefresh()
+{
+    if (!refreshTimer.isActive())
+    {
+        refreshTimer.start();
+    }
+}
 
-        item->setSpeed(transfer->getSpeed(), transfer->getMeanSpeed());
-        item->setTransferredBytes(transfer->getTransferredBytes(), !transfer->isSyncTransfer());
-        item->setTransferState(transfer->getState());
-        item->setPriority(newPriority);
+int QActiveTransfersModel::getRow(TransferItemData *itemData)
+{
+    transfer_it it = std::lower_bound(transferOrder.begin(), transferOrder.end(), itemData, priority_comparator);
+    if (it == transferOrder.end() || (*it)->tag != itemData->tag)
+    {
+        assert(false);
+        return -1;
     }
+    return std::distance(transferOrder.begin(), it);
+}
 
-    if (newPriority == itemData->priority)
+void QActiveTransfersModel::moveTransfer(TransferItemData *itemData, unsigned long long newPriority)
+{
+    std::deque<TransferItemData*>::iterator it = std::lower_bound(transferOrder.begin(), transferOrder.end(), itemData, priority_comparator);
+    int row = std::distance(transferOrder.begin(), it);
+    assert(it != transferOrder.end() && (*it)->tag == itemData->tag);
+    if (it == transferOrder.end() || (*it)->tag != itemData->tag)
     {
-        //Update modified item
-        std::deque<TransferItemData*>::iterator it = std::lower_bound(transferOrder.begin(), transferOrder.end(), itemData, priority_comparator);
-        int row = std::distance(transferOrder.begin(), it);
-        assert(it != transferOrder.end() && (*it)->tag == itemData->tag);
-        if (row >= transferOrder.size())
+        return;
+    }
+
+    TransferItemData testItem;
+    testItem.tag = itemData->tag;
+    testItem.priority = newPriority;
+    std::deque<TransferItemData*>::iterator newit = std::lower_bound(transferOrder.begin(), transferOrder.end(), &testItem, priority_comparator);
+    int newrow = std::distance(transferOrder.begin(), newit);
+
+    if (row == newrow || (row + 1) == newrow)
+    {
+        //Priorities are being adjusted, but there isn't an actual move operation
+        itemData->priority = newPriority;
+    }
+    else
+    {
+        beginMoveRows(QModelIndex(), row, row, QModelIndex(), newrow);
+        transferOrder.erase(it);
+        itemData->priority = newPriority;
+        std::deque<TransferItemData*>::iterator finalit = std::lower_bound(transferOrder.begin(), transferOrder.end(), itemData, priority_comparator);
+        transferOrder.insert(finalit, itemData);
+        endMoveRows();
+    }
+}
+
+void QActiveTransfersModel::applyPendingPriorities()
+{
+    if (pendingPriorities.size() == 1)
+    {
+        TransferItemData *itemData = transfers.value(pendingPriorities.begin().key());
+        unsigned long long newPriority = pendingPriorities.begin().value();
+        pendingPriorities.clear();
+        if (itemData)
         {
-            return;
+            moveTransfer(itemData, newPriority);
         }
-        emit dataChanged(index(row, 0, QModelIndex()), index(row, 0, QModelIndex()));
+        return;
     }
-    else
+
+    //Several moves in the same batch: apply all of them with a single layout change
+    emit layoutAboutToBeChanged();
+    QModelIndexList oldIndexes = persistentIndexList();
+    for (QMap<int, unsigned long long>::iterator it = pendingPriorities.begin(); it != pendingPriorities.end(); ++it)
     {
-        //Move item to its new position
-        std::deque<TransferItemData*>::iterator it = std::lower_bound(transferOrder.begin(), transferOrder.end(), itemData, priority_comparator);
-        int row = std::distance(transferOrder.begin(), it);
-        assert(it != transferOrder.end() && (*it)->tag == itemData->tag);
-        if (it == transferOrder.end() || (*it)->tag != itemData->tag)
+        TransferItemData *itemData = transfers.value(it.key());
+        if (itemData)
         {
-            return;
+            itemData->priority = it.value();
         }
+    }
+    pendingPriorities.clear();
+    std::sort(transferOrder.begin(), transferOrder.end(), priority_comparator);
+
+    QModelIndexList newIndexes;
+    for (int i = 0; i < oldIndexes.size(); i++)
+    {
+        TransferItemData *itemData = transfers.value((int)oldIndexes.at(i).internalId());
+        int row = itemData ? getRow(itemData) : -1;
+        newIndexes.append(row >= 0 ? index(row, oldIndexes.at(i).column(), QModelIndex()) : QModelIndex());
+    }
+    changePersistentIndexList(oldIndexes, newIndexes);
+    emit layoutChanged();
+}
+
+void QActiveTransfersModel::flushPendingUpdates()
+{
+    if (!pendingPriorities.isEmpty())
+    {
+        applyPendingPriorities();
+    }
 
-        TransferItemData testItem;
-        testItem.tag = itemData->tag;
-        testItem.priority = newPriority;
-        std::deque<TransferItemData*>::iterator newit = std::lower_bound(transferOrder.begin(), transferOrder.end(), &testItem, priority_comparator);
-        int newrow = std::distance(transferOrder.begin(), newit);
+    if (dirtyTags.isEmpty())
+    {
+        return;
+    }
 
-        if (row == newrow || (row + 1) == newrow)
+    int firstRow = transferOrder.size();
+    int lastRow = -1;
+    for (QSet<int>::iterator it = dirtyTags.begin(); it != dirtyTags.end(); ++it)
+    {
+        TransferItemData *itemData = transfers.value(*it);
+        if (!itemData)
         {
-            //Priorities are being adjusted, but there isn't an actual move operation
-            itemData->priority = newPriority;
-            emit dataChanged(index(row, 0, QModelIndex()), index(row, 0, QModelIndex()));
+            continue;
         }
-        else
+
+        int row = getRow(itemData);
+        if (row < 0)
         {
-            beginMoveRows(QModelIndex(), row, row, QModelIndex(), newrow);
-            transferOrder.erase(it);
-            itemData->priority = newPriority;
-            std::deque<TransferItemData*>::iterator finalit = std::lower_bound(transferOrder.begin(), transferOrder.end(), itemData, priority_comparator);
-            transferOrder.insert(finalit, itemData);
-            endMoveRows();
+            continue;
         }
+
+        firstRow = qMin(firstRow, row);
+        lastRow = qMax(lastRow, row);
     }
-}
+    dirtyTags.clear();
 
-void QActiveTransfersModel::refreshTransferItem(int tag)
-{
-    TransferItemData *itemData = transfers.value(tag);
-    if (!itemData)
+    if (lastRow >= 0)
     {
-        return;
+        emit dataChanged(index(firstRow, 0, QModelIndex()), index(lastRow, 0, QModelIndex()));
     }
+}
 
-    std::deque<TransferItemData*>::iterator it = std::lower_bound(transferOrder.begin(), transferOrder.end(), itemData, priority_comparator);
-    int row = std::distance(transferOrder.begin(), it);
-    assert(it != transferOrder.end() && (*it)->tag == itemData->tag);
-    if (row >= transferOrder.size())
+void QActiveTransfersModel::refreshTransferItem(int tag)
+{
+    if (!transfers.contains(tag))
     {
         return;
     }
 
-    emit dataChanged(index(row, 0, QModelIndex()), index(row, 0, QModelIndex()));
+    dirtyTags.insert(tag);
+    scheduleRefresh();
 }
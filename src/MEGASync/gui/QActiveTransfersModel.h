@@ -3,7 +3,8 @@
 
 #include <QAbstractItemModel>
 #include <QCache>
-#include "TransferItem.h"
+#include <QTimer>
+#include <QSet>
 #include <megaapi.h>
 #include "QTMegaTransferListener.h"
 #include <deque>
@@ -30,6 +31,9 @@ public:
 
     virtual mega::MegaTransfer *getTransferByTag(int tag);
 
+    // Maximum number of dataChanged/move batches emitted per second (0 = once per event loop iteration)
+    void setMaxRefreshRate(int refreshesPerSecond);
+
     // MegaApi callbacks
     virtual void onTransferStart(mega::MegaApi *api, mega::MegaTransfer *transfer);
     virtual void onTransferFinish(mega::MegaApi* api, mega::MegaTransfer *transfer, mega::MegaError* e);
@@ -38,9 +42,18 @@ public:
 
 protected:
     void updateTransferInfo(mega::MegaTransfer *transfer);
+    void scheduleRefresh();
+    int getRow(TransferItemData *itemData);
+    void moveTransfer(TransferItemData *itemData, unsigned long long newPriority);
+    void applyPendingPriorities();
+
+    QTimer refreshTimer;
+    QSet<int> dirtyTags;
+    QMap<int, unsigned long long> pendingPriorities;
 
 private slots:
     void refreshTransferItem(int tag);
+    void flushPendingUpdates();
 };
 
 #endif // QACTIVETRANSFERSMODEL_H
@@ -5,20 +5,21 @@
 using namespace mega;
 
 QFinishedTransfersModel::QFinishedTransfersModel(QList<MegaTransfer *> finishedTransfers, QObject *parent) :
-    QTransfersModel(QTransfersModel::TYPE_FINISHED, parent)
+    QTransfersModel(QTransfersModel::TYPE_FINISHED, parent),
+    finishedOrder(Preferences::MAX_COMPLETED_ITEMS)
 {
-    int numTransfers = finishedTransfers.size();
+    int numTransfers = qMin(finishedTransfers.size(), finishedOrder.capacity());
     if (numTransfers)
     {
         beginInsertRows(QModelIndex(), 0, numTransfers - 1);
-        for (int i = 0; i < numTransfers; i++)
+        for (int i = finishedTransfers.size() - numTransfers; i < finishedTransfers.size(); i++)
         {
             MegaTransfer *transfer = finishedTransfers.at(i);
             TransferItemData *item = new TransferItemData();
             item->tag = transfer->getTag();
             item->priority = transfer->getPriority();
-            transfers.insert(item->tag, item);
-            transferOrder.push_front(item);
+            finishedOrder.push(item->tag, item);
+            updateRowData(transfer);
         }
         endInsertRows();
     }
@@ -30,27 +31,31 @@ void QFinishedTransfersModel::insertTransfer(MegaTransfer *transfer)
     item->tag = transfer->getTag();
     item->priority = transfer->getPriority();
 
-    if (transfers.size() == Preferences::MAX_COMPLETED_ITEMS)
+    int duplicatedRow = finishedOrder.rowOf(item->tag);
+    if (duplicatedRow >= 0)
     {
-        TransferItemData *t = transferOrder.back();
-        int row = transferOrder.size() - 1;
+        beginRemoveRows(QModelIndex(), duplicatedRow, duplicatedRow);
+        delete finishedOrder.take(item->tag);
+        transferRows.remove(item->tag);
+        endRemoveRows();
+    }
+
+    if (finishedOrder.isFull())
+    {
+        int row = finishedOrder.size() - 1;
         beginRemoveRows(QModelIndex(), row, row);
-        transfers.remove(t->tag);
-        transferOrder.pop_back();
-        transferItems.remove(t->tag);
+        TransferItemData *t = finishedOrder.takeOldest();
+        transferRows.remove(t->tag);
         endRemoveRows();
         delete t;
     }
 
-    transfer_it it = transferOrder.begin();
-    int row = 0;
-
-    beginInsertRows(QModelIndex(), row, row);
-    transfers.insert(item->tag, item);
-    transferOrder.insert(it, item);
+    beginInsertRows(QModelIndex(), 0, 0);
+    finishedOrder.push(item->tag, item);
+    updateRowData(transfer);
     endInsertRows();
 
-    if (transferOrder.size() == 1)
+    if (finishedOrder.size() == 1)
     {
         emit onTransferAdded();
     }
@@ -58,29 +63,20 @@ void QFinishedTransfersModel::insertTransfer(MegaTransfer *transfer)
 
 void QFinishedTransfersModel::removeTransferByTag(int transferTag)
 {
-    TransferItemData *item =  transfers.value(transferTag);
-    if (!item)
+    int row = finishedOrder.rowOf(transferTag);
+    if (row < 0)
     {
         return;
     }
 
-    int row = 0;
-    transfer_it it;
-    for (it = transferOrder.begin(); it != transferOrder.end() && (*it)->tag != transferTag; ++it)
-    {
-        ++row;
-    }
-    assert(row < transferOrder.size());
-
     beginRemoveRows(QModelIndex(), row, row);
-    transfers.remove(transferTag);
-    transferOrder.erase(it);
+    TransferItemData *item = finishedOrder.take(transferTag);
     ((MegaApplication *)qApp)->removeFinishedTransfer(transferTag);
-    transferItems.remove(transferTag);
+    transferRows.remove(transferTag);
     endRemoveRows();
     delete item;
 
-    if (transfers.isEmpty())
+    if (finishedOrder.isEmpty())
     {
         emit noTransfers();
     }
@@ -88,13 +84,12 @@ void QFinishedTransfersModel::removeTransferByTag(int transferTag)
 
 void QFinishedTransfersModel::removeAllTransfers()
 {
-    if (transfers.size())
+    if (finishedOrder.size())
     {
-        beginRemoveRows(QModelIndex(), 0, transfers.size() - 1);
-        qDeleteAll(transfers);
-        transfers.clear();
-        transferOrder.clear();
-        transferItems.clear();
+        beginRemoveRows(QModelIndex(), 0, finishedOrder.size() - 1);
+        qDeleteAll(finishedOrder.values());
+        finishedOrder.clear();
+        transferRows.clear();
         endRemoveRows();
     }
 
@@ -102,6 +97,30 @@ void QFinishedTransfersModel::removeAllTransfers()
     emit noTransfers();
 }
 
+QModelIndex QFinishedTransfersModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent))
+    {
+        return QModelIndex();
+    }
+
+    return createIndex(row, column, finishedOrder.tagAt(row));
+}
+
+int QFinishedTransfersModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+    {
+        return 0;
+    }
+    return finishedOrder.size();
+}
+
+QFinishedTransfersModel::~QFinishedTransfersModel()
+{
+    qDeleteAll(finishedOrder.values());
+}
+
 MegaTransfer *QFinishedTransfersModel::getTransferByTag(int tag)
 {
     return ((MegaApplication *)qApp)->getFinishedTransferByTag(tag);
@@ -117,14 +136,9 @@ void QFinishedTransfersModel::onTransferFinish(MegaApi *, MegaTransfer *transfer
 
 void QFinishedTransfersModel::refreshTransferItem(int tag)
 {
-    int row = 0;
-    for (transfer_it it = transferOrder.begin(); it != transferOrder.end() && (*it)->tag != tag; ++it)
-    {
-        ++row;
-    }
-
-    assert(row < transferOrder.size());
-    if (row >= transferOrder.size())
+    int row = finishedOrder.rowOf(tag);
+    assert(row >= 0);
+    if (row < 0)
     {
         return;
     }
@@ -3,11 +3,11 @@
 
 #include <QAbstractItemModel>
 #include <QCache>
-#include "TransferItem.h"
 #include <megaapi.h>
 #include "QTMegaTransferListener.h"
 #include <deque>
 #include "QTransfersModel.h"
+#include "TransferRingBuffer.h"
 
 class QFinishedTransfersModel : public QTransfersModel
 {
@@ -18,6 +18,9 @@ public:
     void setupModelTransfers();
     void removeTransferByTag(int transferTag);
     void removeAllTransfers();
+    virtual QModelIndex index(int row, int column, const QModelIndex &parent) const;
+    virtual int rowCount(const QModelIndex &parent) const;
+    virtual ~QFinishedTransfersModel();
 
     virtual mega::MegaTransfer *getTransferByTag(int tag);
 
@@ -26,6 +29,8 @@ public:
 protected:
     void insertTransfer(mega::MegaTransfer *transfer);
 
+    TransferRingBuffer<TransferItemData*> finishedOrder;
+
 private slots:
     void refreshTransferItem(int tag);
 };
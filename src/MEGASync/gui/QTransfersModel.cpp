@@ -8,7 +8,6 @@ QTransfersModel::QTransfersModel(int type, QObject *parent) :
 {
     this->type = type;
     this->megaApi = ((MegaApplication *)qApp)->getMegaApi();
-    this->transferItems.setMaxCost(16);
 }
 
 int QTransfersModel::columnCount(const QModelIndex &parent) const
@@ -18,7 +17,7 @@ int QTransfersModel::columnCount(const QModelIndex &parent) const
 
 QVariant QTransfersModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid() || (index.row() < 0 || transfers.count() <= index.row()))
+    if (!index.isValid() || (index.row() < 0 || rowCount(QModelIndex()) <= index.row()))
     {
         return QVariant();
     }
@@ -46,11 +45,47 @@ QModelIndex QTransfersModel::index(int row, int column, const QModelIndex &paren
     return createIndex(row, column, transferOrder[row]->tag);
 }
 
+TransferRowData *QTransfersModel::getRowData(int tag)
+{
+    QHash<int, TransferRowData>::iterator it = transferRows.find(tag);
+    if (it == transferRows.end())
+    {
+        return NULL;
+    }
+    return &it.value();
+}
+
+void QTransfersModel::updateRowData(MegaTransfer *transfer)
+{
+    TransferRowData &rowData = transferRows[transfer->getTag()];
+    if (rowData.type < 0)
+    {
+        rowData.tag = transfer->getTag();
+        rowData.type = transfer->getType();
+        rowData.isSyncTransfer = transfer->isSyncTransfer();
+        rowData.cancellable = !transfer->isSyncTransfer();
+        rowData.fileName = QString::fromUtf8(transfer->getFileName());
+    }
+
+    rowData.state = transfer->getState();
+    rowData.totalSize = qMax(transfer->getTotalBytes(), 0LL);
+    rowData.transferredBytes = qBound(0LL, transfer->getTransferredBytes(), rowData.totalSize);
+    rowData.speed = qMax(transfer->getSpeed(), 0LL);
+    rowData.meanSpeed = transfer->getMeanSpeed();
+    rowData.priority = transfer->getPriority();
+    if (type == TYPE_FINISHED)
+    {
+        rowData.finishedTime = transfer->getUpdateTime();
+    }
+}
+
 void QTransfersModel::refreshTransfers()
 {
-    if (transferOrder.size())
+    // the rows of the finished transfers model aren't kept in transferOrder
+    int rows = rowCount(QModelIndex());
+    if (rows)
     {
-        emit dataChanged(index(0, 0, QModelIndex()), index(transferOrder.size() - 1, 0, QModelIndex()));
+        emit dataChanged(index(0, 0, QModelIndex()), index(rows - 1, 0, QModelIndex()));
     }
 }
 
@@ -2,8 +2,8 @@
 #define QTRANSFERSMODEL_H
 
 #include <QAbstractItemModel>
-#include <QCache>
-#include "TransferItem.h"
+#include <QHash>
+#include "TransferRowPainter.h"
 #include <megaapi.h>
 #include "QTMegaTransferListener.h"
 #include <deque>
@@ -42,8 +42,8 @@ public:
     virtual void removeTransferByTag(int transferTag) = 0;
     virtual void removeAllTransfers() = 0;
     virtual mega::MegaTransfer *getTransferByTag(int tag) = 0;
+    TransferRowData *getRowData(int tag);
 
-    QCache<int, TransferItem> transferItems;
     mega::MegaApi *megaApi;
 
 signals:
@@ -54,7 +54,10 @@ private slots:
     virtual void refreshTransferItem(int tag) = 0;
 
 protected:
+    void updateRowData(mega::MegaTransfer *transfer);
+
     QMap<int, TransferItemData*> transfers;
+    QHash<int, TransferRowData> transferRows;
     std::deque<TransferItemData*> transferOrder;
     int type;
 };
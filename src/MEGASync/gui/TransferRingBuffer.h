@@ -0,0 +1,222 @@
+#ifndef TRANSFERRINGBUFFER_H
+#define TRANSFERRINGBUFFER_H
+
+#include <QVector>
+#include <QHash>
+#include <QList>
+#include <assert.h>
+
+/*
+ * Fixed-capacity circular list of transfers indexed by tag.
+ *
+ * Elements get a monotonically increasing sequence number when they are pushed.
+ * The physical slot of an element is (sequence % capacity) and its row (newest first)
+ * is (newest sequence - sequence), so insertion, eviction of the oldest element,
+ * lookups by tag and row <-> tag mapping are O(1).
+ * Removing an element from the middle shifts the shortest side of the buffer.
+ *
+ * The buffer doesn't own the stored values.
+ */
+template <typename T>
+class TransferRingBuffer
+{
+public:
+    explicit TransferRingBuffer(int capacity)
+    {
+        assert(capacity > 0);
+        entries.resize(capacity);
+        index.reserve(capacity);
+        firstSeq = 0;
+        count = 0;
+    }
+
+    int capacity() const
+    {
+        return entries.size();
+    }
+
+    int size() const
+    {
+        return count;
+    }
+
+    bool isEmpty() const
+    {
+        return !count;
+    }
+
+    bool isFull() const
+    {
+        return count == entries.size();
+    }
+
+    bool contains(int tag) const
+    {
+        return index.contains(tag);
+    }
+
+    T value(int tag) const
+    {
+        typename QHash<int, qint64>::const_iterator it = index.constFind(tag);
+        if (it == index.constEnd())
+        {
+            return T();
+        }
+        return slot(it.value()).value;
+    }
+
+    // Row 0 is the newest element
+    int rowOf(int tag) const
+    {
+        typename QHash<int, qint64>::const_iterator it = index.constFind(tag);
+        if (it == index.constEnd())
+        {
+            return -1;
+        }
+        return int(lastSeq() - it.value());
+    }
+
+    int tagAt(int row) const
+    {
+        assert(row >= 0 && row < count);
+        return slot(lastSeq() - row).tag;
+    }
+
+    T at(int row) const
+    {
+        assert(row >= 0 && row < count);
+        return slot(lastSeq() - row).value;
+    }
+
+    T oldest() const
+    {
+        return count ? slot(firstSeq).value : T();
+    }
+
+    int oldestTag() const
+    {
+        assert(count);
+        return slot(firstSeq).tag;
+    }
+
+    // The caller must make room (takeOldest) if the buffer is full
+    void push(int tag, T value)
+    {
+        assert(!isFull() && !index.contains(tag));
+        qint64 seq = firstSeq + count;
+        Slot &s = slot(seq);
+        s.tag = tag;
+        s.value = value;
+        index.insert(tag, seq);
+        count++;
+    }
+
+    T takeOldest()
+    {
+        if (!count)
+        {
+            return T();
+        }
+
+        Slot &s = slot(firstSeq);
+        T value = s.value;
+        index.remove(s.tag);
+        s.value = T();
+        firstSeq++;
+        count--;
+        return value;
+    }
+
+    T take(int tag)
+    {
+        typename QHash<int, qint64>::iterator it = index.find(tag);
+        if (it == index.end())
+        {
+            return T();
+        }
+
+        qint64 seq = it.value();
+        index.erase(it);
+        T value = slot(seq).value;
+
+        if (seq - firstSeq < lastSeq() - seq)
+        {
+            // Closer to the oldest end: move older elements one position forward
+            for (qint64 q = seq; q > firstSeq; q--)
+            {
+                Slot &dst = slot(q);
+                dst = slot(q - 1);
+                index[dst.tag] = q;
+            }
+            slot(firstSeq).value = T();
+            firstSeq++;
+        }
+        else
+        {
+            // Closer to the newest end: move newer elements one position back
+            qint64 last = lastSeq();
+            for (qint64 q = seq; q < last; q++)
+            {
+                Slot &dst = slot(q);
+                dst = slot(q + 1);
+                index[dst.tag] = q;
+            }
+            slot(last).value = T();
+        }
+        count--;
+        return value;
+    }
+
+    // Oldest first
+    QList<T> values() const
+    {
+        QList<T> result;
+        result.reserve(count);
+        for (qint64 q = firstSeq; q < firstSeq + count; q++)
+        {
+            result.append(slot(q).value);
+        }
+        return result;
+    }
+
+    void clear()
+    {
+        for (int i = 0; i < entries.size(); i++)
+        {
+            entries[i].value = T();
+        }
+        index.clear();
+        firstSeq = 0;
+        count = 0;
+    }
+
+private:
+    struct Slot
+    {
+        Slot() : tag(0), value() {}
+        int tag;
+        T value;
+    };
+
+    qint64 lastSeq() const
+    {
+        return firstSeq + count - 1;
+    }
+
+    Slot &slot(qint64 seq)
+    {
+        return entries[int(seq % entries.size())];
+    }
+
+    const Slot &slot(qint64 seq) const
+    {
+        return entries.at(int(seq % entries.size()));
+    }
+
+    QVector<Slot> entries;
+    QHash<int, qint64> index;
+    qint64 firstSeq;
+    int count;
+};
+
+#endif // TRANSFERRINGBUFFER_H
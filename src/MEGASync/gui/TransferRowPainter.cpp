@@ -0,0 +1,436 @@
+#include "TransferRowPainter.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include "control/Utilities.h"
+#include "Preferences.h"
+#include "megaapi.h"
+
+using namespace mega;
+
+// Row geometry follows the layout of the former TransferItem widget, whose
+// translation context is kept for the strings painted here
+namespace {
+const int LEFT_CONTAINER_WIDTH = 608;
+const int FINISHED_CONTAINER_WIDTH = 550;
+const int TYPE_ICON_X = 10;
+const int FILE_ICON_X = 28;
+const int NAME_X = 56;
+const int TOTAL_WIDTH = 150;
+const int ACTION_ICON_X = 620;
+const int TIME_X = 660;
+const int TIME_WIDTH = 70;
+const int CANCEL_X = 740;
+const int PROGRESS_BAR_HEIGHT = 2;
+
+// Metrics that were different in the TransferItem.ui of each platform
+#ifdef WIN32
+const int NAME_FONT_SIZE = 16;
+const int INFO_FONT_SIZE = 13;
+const int SPEED_WIDTH = 120;
+const int FINISHED_NAME_MAX_WIDTH = 0;
+#elif defined(__APPLE__)
+const int NAME_FONT_SIZE = 14;
+const int INFO_FONT_SIZE = 11;
+const int SPEED_WIDTH = 84;
+const int FINISHED_NAME_MAX_WIDTH = 330;
+#else
+const int NAME_FONT_SIZE = 14;
+const int INFO_FONT_SIZE = 11;
+const int SPEED_WIDTH = 84;
+const int FINISHED_NAME_MAX_WIDTH = 0;
+#endif
+}
+
+TransferRowData::TransferRowData()
+{
+    tag = 0;
+    type = -1;
+    state = 0;
+    isSyncTransfer = false;
+    cancellable = false;
+    totalSize = 0;
+    transferredBytes = 0;
+    speed = 0;
+    meanSpeed = 0;
+    finishedTime = 0;
+    priority = 0;
+}
+
+TransferRowPainter::TransferRowPainter(QObject *parent) :
+    QObject(parent)
+{
+    bool hdpi = Utilities::getDevicePixelRatio() >= 2;
+    uploadTypeIcon = QPixmap(QString::fromUtf8(":/images/upload_item_ico.png"));
+    downloadTypeIcon = QPixmap(QString::fromUtf8(":/images/download_item_ico.png"));
+    cloudIcon = QPixmap(hdpi ? QString::fromUtf8(":/images/cloud_item_ico@2x.png")
+                             : QString::fromUtf8(":/images/cloud_item_ico.png"));
+    syncIcon = QPixmap(hdpi ? QString::fromUtf8(":/images/sync_item_ico@2x.png")
+                            : QString::fromUtf8(":/images/sync_item_ico.png"));
+    cancelIcon = QPixmap(QString::fromUtf8(":/images/clear_item_ico.png"));
+    completedIcon = QPixmap(QString::fromUtf8(":/images/completed_item_ico.png"));
+    failedIcon = QPixmap(QString::fromUtf8(":/images/import_error_ico.png"));
+
+    animations[ANIMATION_UPLOAD] = new QMovie(hdpi ? QString::fromUtf8(":/images/uploading@2x.gif")
+                                                   : QString::fromUtf8(":/images/uploading.gif"), QByteArray(), this);
+    animations[ANIMATION_DOWNLOAD] = new QMovie(hdpi ? QString::fromUtf8(":/images/downloading@2x.gif")
+                                                     : QString::fromUtf8(":/images/downloading.gif"), QByteArray(), this);
+    animations[ANIMATION_SYNC] = new QMovie(hdpi ? QString::fromUtf8(":/images/synching@2x.gif")
+                                                 : QString::fromUtf8(":/images/synching.gif"), QByteArray(), this);
+    for (int i = 0; i < NUM_ANIMATIONS; i++)
+    {
+        animationPainted[i] = false;
+        connect(animations[i], SIGNAL(frameChanged(int)), this, SLOT(onFrameChanged(int)));
+    }
+
+    nameFont.setFamily(QString::fromUtf8("Source Sans Pro"));
+    nameFont.setPixelSize(NAME_FONT_SIZE);
+    infoFont.setFamily(QString::fromUtf8("Source Sans Pro"));
+    infoFont.setPixelSize(INFO_FONT_SIZE);
+    timeFont.setFamily(QString::fromUtf8("Source Sans Pro"));
+    timeFont.setPixelSize(10);
+}
+
+TransferRowPainter::~TransferRowPainter()
+{
+    for (int i = 0; i < NUM_ANIMATIONS; i++)
+    {
+        animations[i]->stop();
+    }
+}
+
+void TransferRowPainter::paint(QPainter *painter, const QRect &rect, const TransferRowData &data, bool paused, bool hovered)
+{
+    painter->save();
+    if (isFinished(data))
+    {
+        paintFinished(painter, rect, data);
+    }
+    else
+    {
+        paintActive(painter, rect, data, paused);
+    }
+
+    if (hovered && canBeCancelled(data))
+    {
+        painter->drawPixmap(cancelButtonRect(rect), cancelIcon);
+    }
+    painter->restore();
+}
+
+bool TransferRowPainter::cancelButtonClicked(const QRect &rect, const TransferRowData &data, const QPoint &pos) const
+{
+    if (data.state == MegaTransfer::STATE_CANCELLED || !canBeCancelled(data))
+    {
+        return false;
+    }
+
+    return cancelButtonRect(rect).contains(pos);
+}
+
+QRect TransferRowPainter::nameRect(const QRect &rect, const TransferRowData &data) const
+{
+    return QRect(rect.left() + NAME_X, rect.top(), nameWidth(data), rect.height() - 4);
+}
+
+bool TransferRowPainter::isFinished(const TransferRowData &data)
+{
+    return data.state == MegaTransfer::STATE_COMPLETED || data.state == MegaTransfer::STATE_FAILED;
+}
+
+void TransferRowPainter::onFrameChanged(int)
+{
+    for (int i = 0; i < NUM_ANIMATIONS; i++)
+    {
+        if (animations[i] != sender())
+        {
+            continue;
+        }
+
+        if (!animationPainted[i])
+        {
+            // No visible row has used this animation since the last frame
+            animations[i]->stop();
+            return;
+        }
+
+        animationPainted[i] = false;
+        emit animationFrameChanged();
+        return;
+    }
+}
+
+void TransferRowPainter::paintActive(QPainter *painter, const QRect &rect, const TransferRowData &data, bool paused)
+{
+    int left = rect.left();
+    paintCommon(painter, rect, data);
+
+    // Transferred bytes
+    QRect totalRect(left + LEFT_CONTAINER_WIDTH - SPEED_WIDTH - TOTAL_WIDTH, rect.top(), TOTAL_WIDTH, rect.height() - 4);
+    painter->setFont(infoFont);
+    QString totalString = Utilities::getSizeString(data.totalSize);
+    if (data.transferredBytes)
+    {
+        QString ofString = QString::fromUtf8("  of  ");
+        QFontMetrics fm(infoFont);
+        int totalWidth = fm.width(totalString);
+        int ofWidth = fm.width(ofString);
+        painter->setPen(QColor(0x33, 0x33, 0x33));
+        painter->drawText(totalRect, Qt::AlignRight | Qt::AlignVCenter, totalString);
+        painter->setPen(QColor(0x77, 0x77, 0x77));
+        painter->drawText(totalRect.adjusted(0, 0, -totalWidth, 0), Qt::AlignRight | Qt::AlignVCenter, ofString);
+        painter->setPen(QColor(0x33, 0x33, 0x33));
+        painter->drawText(totalRect.adjusted(0, 0, -totalWidth - ofWidth, 0), Qt::AlignRight | Qt::AlignVCenter,
+                          Utilities::getSizeString(data.transferredBytes));
+    }
+    else
+    {
+        painter->setPen(QColor(0x33, 0x33, 0x33));
+        painter->drawText(totalRect, Qt::AlignRight | Qt::AlignVCenter, totalString);
+    }
+
+    // Speed / state and remaining time
+    QString stateString;
+    QString remainingTime;
+    if (paused)
+    {
+        stateString = QString::fromUtf8("(%1)").arg(QCoreApplication::translate("TransferItem", "paused"));
+    }
+    else
+    {
+        switch (data.state)
+        {
+            case MegaTransfer::STATE_ACTIVE:
+            {
+                long long remainingBytes = data.totalSize - data.transferredBytes;
+                int totalRemainingSeconds = data.meanSpeed ? remainingBytes / data.meanSpeed : 0;
+                if (totalRemainingSeconds)
+                {
+                    remainingTime = (totalRemainingSeconds < 60) ? QString::fromUtf8("< 1 m")
+                                                                 : toPlainText(Utilities::getTimeString(totalRemainingSeconds, false));
+                }
+
+                stateString = !data.transferredBytes ? QString::fromUtf8("(%1)").arg(QCoreApplication::translate("TransferItem", "starting"))
+                                                     : QString::fromUtf8("(%1/s)").arg(Utilities::getSizeString(data.speed));
+                break;
+            }
+            case MegaTransfer::STATE_PAUSED:
+                stateString = QString::fromUtf8("(%1)").arg(QCoreApplication::translate("TransferItem", "paused"));
+                break;
+            case MegaTransfer::STATE_QUEUED:
+                stateString = QString::fromUtf8("(%1)").arg(QCoreApplication::translate("TransferItem", "queued"));
+                break;
+            case MegaTransfer::STATE_RETRYING:
+                stateString = QString::fromUtf8("(%1)").arg(QCoreApplication::translate("TransferItem", "retrying"));
+                break;
+            case MegaTransfer::STATE_COMPLETING:
+                stateString = QString::fromUtf8("(%1)").arg(QCoreApplication::translate("TransferItem", "completing"));
+                break;
+            default:
+                break;
+        }
+    }
+
+    QRect speedRect(left + LEFT_CONTAINER_WIDTH - SPEED_WIDTH, rect.top(), SPEED_WIDTH, rect.height() - 4);
+    painter->setPen(QColor(0xaa, 0xaa, 0xaa));
+    painter->drawText(speedRect, Qt::AlignRight | Qt::AlignVCenter, stateString);
+
+    QRect timeRect(left + TIME_X, rect.top(), TIME_WIDTH, rect.height());
+    painter->setPen(QColor(0x33, 0x33, 0x33));
+    painter->drawText(timeRect, Qt::AlignCenter, remainingTime);
+
+    // Progress bar
+    QRect barRect(left + TYPE_ICON_X, rect.bottom() - 6, LEFT_CONTAINER_WIDTH - TYPE_ICON_X, PROGRESS_BAR_HEIGHT);
+    painter->fillRect(barRect, QColor(0xec, 0xec, 0xec));
+    if (data.totalSize > 0 && data.transferredBytes > 0)
+    {
+        int chunkWidth = (int)((barRect.width() * qMin(data.transferredBytes, data.totalSize)) / data.totalSize);
+        QColor chunkColor = (data.type == MegaTransfer::TYPE_UPLOAD) ? QColor(0x2b, 0xa6, 0xde) : QColor(0x31, 0xb5, 0x00);
+        painter->fillRect(QRect(barRect.left(), barRect.top(), chunkWidth, barRect.height()), chunkColor);
+    }
+
+    painter->drawPixmap(QRect(left + ACTION_ICON_X, rect.top() + (rect.height() - 32) / 2, 32, 32), actionPixmap(data, paused));
+}
+
+void TransferRowPainter::paintFinished(QPainter *painter, const QRect &rect, const TransferRowData &data)
+{
+    int left = rect.left();
+    paintCommon(painter, rect, data);
+
+    int stateX = left + NAME_X + nameWidth(data) + 30;
+    painter->drawPixmap(QRect(stateX, rect.top() + (rect.height() - 12) / 2, 12, 12),
+                        data.state == MegaTransfer::STATE_COMPLETED ? completedIcon : failedIcon);
+
+    painter->setFont(infoFont);
+    painter->setPen(QColor(0x33, 0x33, 0x33));
+    painter->drawText(QRect(stateX + 18, rect.top(), left + FINISHED_CONTAINER_WIDTH - stateX - 18, rect.height()),
+                      Qt::AlignLeft | Qt::AlignVCenter, Utilities::getSizeString(data.totalSize));
+
+    painter->setFont(timeFont);
+    painter->drawText(QRect(left + FINISHED_CONTAINER_WIDTH + 10, rect.top(), ACTION_ICON_X - FINISHED_CONTAINER_WIDTH - 20, rect.height()),
+                      Qt::AlignRight | Qt::AlignVCenter, getFinishedTimeString(data.finishedTime));
+
+    painter->drawPixmap(QRect(left + ACTION_ICON_X, rect.top() + (rect.height() - 32) / 2, 32, 32),
+                        data.isSyncTransfer ? syncIcon : cloudIcon);
+}
+
+void TransferRowPainter::paintCommon(QPainter *painter, const QRect &rect, const TransferRowData &data)
+{
+    int left = rect.left();
+    int middle = rect.top() + rect.height() / 2;
+    if (data.type == MegaTransfer::TYPE_UPLOAD)
+    {
+        painter->drawPixmap(QRect(left + TYPE_ICON_X, middle - 6, 12, 12), uploadTypeIcon);
+    }
+    else if (data.type == MegaTransfer::TYPE_DOWNLOAD)
+    {
+        painter->drawPixmap(QRect(left + TYPE_ICON_X, middle - 6, 12, 12), downloadTypeIcon);
+    }
+    painter->drawPixmap(QRect(left + FILE_ICON_X, middle - 11, 20, 22), extensionPixmap(data.fileName));
+
+    QFontMetrics fm(nameFont);
+    QRect textRect = nameRect(rect, data);
+    painter->setFont(nameFont);
+    painter->setPen(QColor(0x33, 0x33, 0x33));
+    painter->drawText(textRect, Qt::AlignLeft | Qt::AlignVCenter,
+                      fm.elidedText(data.fileName, Qt::ElideRight, textRect.width()));
+}
+
+int TransferRowPainter::nameWidth(const TransferRowData &data) const
+{
+    if (!isFinished(data))
+    {
+        return LEFT_CONTAINER_WIDTH - NAME_X - TOTAL_WIDTH - SPEED_WIDTH - 10;
+    }
+
+    int width = FINISHED_CONTAINER_WIDTH - NAME_X - 30 - 12 - TOTAL_WIDTH / 2;
+    if (FINISHED_NAME_MAX_WIDTH)
+    {
+        width = qMin(width, FINISHED_NAME_MAX_WIDTH);
+    }
+    return width;
+}
+
+QRect TransferRowPainter::cancelButtonRect(const QRect &rect) const
+{
+    return QRect(rect.left() + CANCEL_X, rect.top() + (rect.height() - 12) / 2, 12, 12);
+}
+
+const QPixmap &TransferRowPainter::extensionPixmap(const QString &fileName)
+{
+    QString resource = Utilities::getExtensionPixmapSmall(fileName);
+    QHash<QString, QPixmap>::iterator it = extensionPixmaps.find(resource);
+    if (it == extensionPixmaps.end())
+    {
+        it = extensionPixmaps.insert(resource, QPixmap(resource));
+    }
+    return it.value();
+}
+
+QPixmap TransferRowPainter::actionPixmap(const TransferRowData &data, bool paused)
+{
+    const QPixmap &defaultIcon = data.isSyncTransfer ? syncIcon : cloudIcon;
+    if (paused || data.state != MegaTransfer::STATE_ACTIVE)
+    {
+        return defaultIcon;
+    }
+
+    int animation;
+    if (data.isSyncTransfer)
+    {
+        animation = ANIMATION_SYNC;
+    }
+    else if (data.type == MegaTransfer::TYPE_UPLOAD)
+    {
+        animation = ANIMATION_UPLOAD;
+    }
+    else if (data.type == MegaTransfer::TYPE_DOWNLOAD)
+    {
+        animation = ANIMATION_DOWNLOAD;
+    }
+    else
+    {
+        return defaultIcon;
+    }
+
+    QMovie *movie = animations[animation];
+    animationPainted[animation] = true;
+    if (movie->state() != QMovie::Running)
+    {
+        movie->start();
+    }
+
+    QPixmap frame = movie->currentPixmap();
+    return frame.isNull() ? defaultIcon : frame;
+}
+
+QString TransferRowPainter::getFinishedTimeString(long long dsFinishedTime)
+{
+    if (!dsFinishedTime)
+    {
+        return QString();
+    }
+
+    Preferences *preferences = Preferences::instance();
+    qint64 secs = (QDateTime::currentMSecsSinceEpoch() / 100 - (preferences->getMsDiffTimeWithSDK() + dsFinishedTime)) / 10;
+    if (secs < 2)
+    {
+        return QCoreApplication::translate("TransferItem", "just now");
+    }
+    if (secs < 60)
+    {
+        return QCoreApplication::translate("TransferItem", "%1 seconds ago").arg(secs);
+    }
+    if (secs < 3600)
+    {
+        int minutes = secs / 60;
+        return minutes == 1 ? QCoreApplication::translate("TransferItem", "1 minute ago") : QCoreApplication::translate("TransferItem", "%1 minutes ago").arg(minutes);
+    }
+    if (secs < 86400)
+    {
+        int hours = secs / 3600;
+        return hours == 1 ? QCoreApplication::translate("TransferItem", "1 hour ago") : QCoreApplication::translate("TransferItem", "%1 hours ago").arg(hours);
+    }
+    if (secs < 2592000)
+    {
+        int days = secs / 86400;
+        return days == 1 ? QCoreApplication::translate("TransferItem", "1 day ago") : QCoreApplication::translate("TransferItem", "%1 days ago").arg(days);
+    }
+    if (secs < 31536000)
+    {
+        int months = secs / 2592000;
+        return months == 1 ? QCoreApplication::translate("TransferItem", "1 month ago") : QCoreApplication::translate("TransferItem", "%1 months ago").arg(months);
+    }
+
+    int years = secs / 31536000;
+    return years == 1 ? QCoreApplication::translate("TransferItem", "1 year ago") : QCoreApplication::translate("TransferItem", "%1 years ago").arg(years);
+}
+
+QString TransferRowPainter::toPlainText(const QString &html)
+{
+    QString text;
+    text.reserve(html.size());
+    bool inTag = false;
+    for (int i = 0; i < html.size(); i++)
+    {
+        QChar c = html.at(i);
+        if (c == QLatin1Char('<'))
+        {
+            inTag = true;
+        }
+        else if (c == QLatin1Char('>'))
+        {
+            inTag = false;
+        }
+        else if (!inTag)
+        {
+            text.append(c);
+        }
+    }
+    return text;
+}
+
+bool TransferRowPainter::canBeCancelled(const TransferRowData &data)
+{
+    // Active sync transfers can't be cancelled from the transfer list
+    return !data.isSyncTransfer || isFinished(data);
+}
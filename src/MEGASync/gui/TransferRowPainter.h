@@ -0,0 +1,94 @@
+#ifndef TRANSFERROWPAINTER_H
+#define TRANSFERROWPAINTER_H
+
+#include <QObject>
+#include <QPainter>
+#include <QPixmap>
+#include <QMovie>
+#include <QHash>
+#include <QFont>
+
+// Snapshot of the fields of a transfer that are needed to paint its row
+class TransferRowData
+{
+public:
+    TransferRowData();
+
+    int tag;
+    int type;
+    int state;
+    bool isSyncTransfer;
+    bool cancellable;
+    long long totalSize;
+    long long transferredBytes;
+    long long speed;
+    long long meanSpeed;
+    long long finishedTime;
+    unsigned long long priority;
+    QString fileName;
+};
+
+/*
+ * Draws transfer rows directly with QPainter.
+ *
+ * Pixmaps are loaded once and shared by all rows. There is a single QMovie per kind of
+ * animation, it only runs while at least one visible row is using it.
+ */
+class TransferRowPainter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TransferRowPainter(QObject *parent = 0);
+    ~TransferRowPainter();
+
+    void paint(QPainter *painter, const QRect &rect, const TransferRowData &data, bool paused, bool hovered);
+    bool cancelButtonClicked(const QRect &rect, const TransferRowData &data, const QPoint &pos) const;
+    // area of the file name, it shows the full name in a tooltip
+    QRect nameRect(const QRect &rect, const TransferRowData &data) const;
+
+    static bool isFinished(const TransferRowData &data);
+
+signals:
+    void animationFrameChanged();
+
+private slots:
+    void onFrameChanged(int);
+
+private:
+    enum {
+        ANIMATION_UPLOAD = 0,
+        ANIMATION_DOWNLOAD,
+        ANIMATION_SYNC,
+        NUM_ANIMATIONS
+    };
+
+    void paintActive(QPainter *painter, const QRect &rect, const TransferRowData &data, bool paused);
+    void paintFinished(QPainter *painter, const QRect &rect, const TransferRowData &data);
+    void paintCommon(QPainter *painter, const QRect &rect, const TransferRowData &data);
+    int nameWidth(const TransferRowData &data) const;
+    QRect cancelButtonRect(const QRect &rect) const;
+    const QPixmap &extensionPixmap(const QString &fileName);
+    QPixmap actionPixmap(const TransferRowData &data, bool paused);
+    QString getFinishedTimeString(long long dsFinishedTime);
+    static QString toPlainText(const QString &html);
+    static bool canBeCancelled(const TransferRowData &data);
+
+    QMovie *animations[NUM_ANIMATIONS];
+    bool animationPainted[NUM_ANIMATIONS];
+
+    QPixmap uploadTypeIcon;
+    QPixmap downloadTypeIcon;
+    QPixmap cloudIcon;
+    QPixmap syncIcon;
+    QPixmap cancelIcon;
+    QPixmap completedIcon;
+    QPixmap failedIcon;
+    QHash<QString, QPixmap> extensionPixmaps;
+
+    QFont nameFont;
+    QFont infoFont;
+    QFont timeFont;
+};
+
+#endif // TRANSFERROWPAINTER_H
@@ -76,6 +76,7 @@ void TransfersWidget::configureTransferView()
     }
 
     tDelegate = new MegaTransferDelegate(model, this);
+    connect(tDelegate, SIGNAL(animationFrameChanged()), ui->tvTransfers->viewport(), SLOT(update()));
     ui->tvTransfers->setup(type);
     ui->tvTransfers->setItemDelegate((QAbstractItemDelegate *)tDelegate);
     ui->tvTransfers->header()->close();
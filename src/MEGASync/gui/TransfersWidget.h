@@ -2,7 +2,6 @@
 #define TRANSFERSWIDGET_H
 
 #include <QWidget>
-#include "TransferItem.h"
 #include "QTransfersModel.h"
 #include "QActiveTransfersModel.h"
 #include "QFinishedTransfersModel.h"
@@ -33,7 +32,6 @@ public:
 
 private:
     Ui::TransfersWidget *ui;
-    QList<TransferItem *> activeTransfers;
     QTransfersModel *model;
     MegaTransferDelegate *tDelegate;
     int type;
@@ -2,17 +2,43 @@
 #include <sys/types.h>
 #include <pwd.h>
 #include <unistd.h>
+#include <climits>
 #include "control/Utilities.h"
 
 using namespace mega;
 using namespace std;
 
+// requests are "<op>:<content>\n", answers are terminated by a newline too
+// batched path state request: "B:" + NUL-separated paths + "\n"
+// the answer is one state character per path + "\n"
+static const char OP_BATCH_PATH_STATE[] = "B:";
+
+// maximum size of an unterminated request, the client is disconnected past it
+#define MAX_REQUEST_SIZE (8 * 1024 * 1024)
+
+#define RESPONSE_DEFAULT    "9"
+#define RESPONSE_ERROR      "0"
+#define RESPONSE_SYNCED     "1"
+#define RESPONSE_PENDING    "2"
+#define RESPONSE_SYNCING    "3"
+
 ExtServer::ExtServer(MegaApplication *app): QObject(),
-    m_localServer(0)
+    m_localServer(0),
+    nextRequestId(0)
 {
     connect(this, SIGNAL(newUploadQueue(QQueue<QString>)), app, SLOT(shellUpload(QQueue<QString>)),Qt::QueuedConnection);
     connect(this, SIGNAL(newExportQueue(QQueue<QString>)), app, SLOT(shellExport(QQueue<QString>)),Qt::QueuedConnection);
 
+    // path states are resolved in a worker thread so that several clients
+    // don't have to wait for the GUI thread
+    resolverThread = new QThread();
+    resolver = new PathStateResolver();
+    resolver->moveToThread(resolverThread);
+    connect(this, SIGNAL(resolvePathState(int, QByteArray)), resolver, SLOT(resolve(int, QByteArray)), Qt::QueuedConnection);
+    connect(resolver, SIGNAL(resolved(int, QByteArray)), this, SLOT(onPathStateResolved(int, QByteArray)), Qt::QueuedConnection);
+    connect(resolverThread, SIGNAL(finished()), resolver, SLOT(deleteLater()));
+    resolverThread->start();
+
     // construct local socket path
     sockPath = MegaApplication::applicationDataPath() + QDir::separator() + QString::fromAscii("mega.socket");
 
@@ -35,6 +61,10 @@ ExtServer::ExtServer(MegaApplication *app): QObject(),
 
 ExtServer::~ExtServer()
 {
+    resolverThread->quit();
+    resolverThread->wait();
+    delete resolverThread;
+
     qDeleteAll(m_clients);
     QLocalServer::removeServer(sockPath);
     m_localServer->close();
@@ -65,6 +95,15 @@ void ExtServer::onClientDisconnected()
     if (!client)
         return;
     m_clients.removeAll(client);
+    m_pendingData.remove(client);
+    QList<PendingAnswer> answers = m_pendingAnswers.take(client);
+    for (int i = 0; i < answers.size(); i++)
+    {
+        if (!answers.at(i).ready)
+        {
+            m_requestOwners.remove(answers.at(i).requestId);
+        }
+    }
     client->deleteLater();
 
     //LOG_debug << "Client disconnected";
@@ -82,42 +121,167 @@ void ExtServer::onClientData()
         return;
     }
 
-    qint64 len;
-    char buf[1024];
-    while ((len = client->readLine(buf, sizeof(buf))) > 0) {
-        const char *out = GetAnswerToRequest(buf);
-        if (out) {
-            qint64 len = client->write(out);
-            client->write("\n");
+    // requests are terminated by a newline and can span several reads
+    QByteArray &buffer = m_pendingData[client];
+    buffer.append(client->readAll());
+    int start = 0;
+    int end;
+    while ((end = buffer.indexOf('\n', start)) >= 0) {
+        processRequest(client, buffer.mid(start, end - start));
+        start = end + 1;
+    }
+    buffer.remove(0, start);
+
+    if (buffer.size() > MAX_REQUEST_SIZE) {
+        // the client isn't following the protocol
+        buffer.clear();
+        sendReadyAnswers(client);
+        client->disconnectFromServer();
+        return;
+    }
+
+    sendReadyAnswers(client);
+}
+
+// queue the answer to a request, path states are resolved asynchronously
+void ExtServer::processRequest(QLocalSocket *client, const QByteArray &request)
+{
+    PendingAnswer answer;
+    answer.requestId = -1;
+    answer.ready = true;
+
+    bool pathState = request.startsWith(OP_BATCH_PATH_STATE) || request.startsWith("P:");
+    if (pathState && Preferences::instance()->overlayIconsDisabled())
+    {
+        int numPaths = request.at(0) == 'B' ? request.count('\0') + 1 : 1;
+        answer.data = QByteArray(numPaths, RESPONSE_DEFAULT[0]);
+    }
+    else if (pathState)
+    {
+        answer.requestId = nextRequestId;
+        nextRequestId = (nextRequestId == INT_MAX) ? 0 : nextRequestId + 1;
+        answer.ready = false;
+        m_requestOwners.insert(answer.requestId, client);
+        emit resolvePathState(answer.requestId, request);
+    }
+    else
+    {
+        answer.data = GetAnswerToRequest(request);
+    }
+
+    m_pendingAnswers[client].append(answer);
+}
+
+// write the answers that are ready, stopping at the first one still being resolved
+void ExtServer::sendReadyAnswers(QLocalSocket *client)
+{
+    QHash<QLocalSocket *, QList<PendingAnswer> >::iterator it = m_pendingAnswers.find(client);
+    if (it == m_pendingAnswers.end())
+    {
+        return;
+    }
+
+    QList<PendingAnswer> &answers = it.value();
+    while (!answers.isEmpty() && answers.first().ready)
+    {
+        client->write(answers.first().data);
+        client->write("\n");
+        answers.removeFirst();
+    }
+
+    if (answers.isEmpty())
+    {
+        m_pendingAnswers.erase(it);
+    }
+}
+
+void ExtServer::onPathStateResolved(int requestId, QByteArray answer)
+{
+    // the client could have disconnected in the meantime
+    QLocalSocket *client = m_requestOwners.take(requestId);
+    if (!client)
+    {
+        return;
+    }
+
+    QList<PendingAnswer> &answers = m_pendingAnswers[client];
+    for (int i = 0; i < answers.size(); i++)
+    {
+        if (answers.at(i).requestId == requestId && !answers.at(i).ready)
+        {
+            answers[i].ready = true;
+            answers[i].data = answer;
+            break;
         }
     }
+
+    sendReadyAnswers(client);
+}
+
+
+PathStateResolver *ExtServer::getPathStateResolver() const
+{
+    return resolver;
+}
+
+const char *ExtServer::getPathStateResponse(const char *path)
+{
+    string tmpPath(path);
+    int state = ((MegaApplication *)qApp)->getMegaApi()->syncPathState(&tmpPath);
+    switch(state)
+    {
+        case MegaApi::STATE_SYNCED:
+            return RESPONSE_SYNCED;
+        case MegaApi::STATE_SYNCING:
+            return RESPONSE_SYNCING;
+        case MegaApi::STATE_PENDING:
+            return RESPONSE_PENDING;
+        case MegaApi::STATE_NONE:
+        case MegaApi::STATE_IGNORED:
+        default:
+            return RESPONSE_DEFAULT;
+    }
+}
+
+// parse a batch of NUL-separated paths and return one state character per path
+QByteArray ExtServer::GetAnswerToBatchRequest(const QByteArray &content)
+{
+    QList<QByteArray> paths = content.split('\0');
+    QByteArray out;
+    out.reserve(paths.size());
+
+    for (int i = 0; i < paths.size(); i++)
+    {
+        out.append(getPathStateResponse(paths.at(i).constData()));
+    }
+    return out;
 }
 
-#define BUFSIZE 1024
-#define RESPONSE_DEFAULT    "9"
-#define RESPONSE_ERROR      "0"
-#define RESPONSE_SYNCED     "1"
-#define RESPONSE_PENDING    "2"
-#define RESPONSE_SYNCING    "3"
 // parse incoming request and send response back to client
-const char *ExtServer::GetAnswerToRequest(const char *buf)
+// path state requests are answered by PathStateResolver
+QByteArray ExtServer::GetAnswerToRequest(const QByteArray &request)
 {
-    char c = buf[0];
-    const char *content = buf+2;
-    static char out[BUFSIZE];
+    if (request.isEmpty())
+    {
+        return QByteArray();
+    }
+
+    char c = request.at(0);
+    QByteArray content = request.mid(2);
+    QByteArray out;
 
     switch(c)
     {
         // send translated string
         case 'T':
         {
-            if (strlen(buf) < 3)
+            if (content.isEmpty())
             {
                 break;
             }
 
             bool ok;
-            QStringList parameters = QString::fromAscii(content).split(QChar::fromAscii(':'));
+            QStringList parameters = QString::fromAscii(content.constData()).split(QChar::fromAscii(':'));
 
             if (parameters.size() != 3)
             {
@@ -196,12 +360,12 @@ const char *ExtServer::GetAnswerToRequest(const char *buf)
                         .arg(actionString).arg(sNumFolders);
             }
 
-            strncpy(out, fullString.toUtf8().constData(), BUFSIZE);
+            out = fullString.toUtf8();
             break;
         }
         case 'F':
         {
-            QString filePath = QString::fromUtf8(content);
+            QString filePath = QString::fromUtf8(content.constData());
             QFileInfo file(filePath);
             if (file.exists())
             {
@@ -212,7 +376,7 @@ const char *ExtServer::GetAnswerToRequest(const char *buf)
         }
         case 'L':
         {
-            QString filePath = QString::fromUtf8(content);
+            QString filePath = QString::fromUtf8(content.constData());
             QFileInfo file(filePath);
             if (file.exists())
             {
@@ -220,34 +384,6 @@ const char *ExtServer::GetAnswerToRequest(const char *buf)
             }
             break;
         }
-        // get the state of an object
-        case 'P':
-        {
-            int state = MegaApi::STATE_NONE;
-            if (!Preferences::instance()->overlayIconsDisabled())
-            {
-                string tmpPath(content);
-                state = ((MegaApplication *)qApp)->getMegaApi()->syncPathState(&tmpPath);
-            }
-
-            switch(state)
-            {
-                case MegaApi::STATE_SYNCED:
-                    strncpy(out, RESPONSE_SYNCED, BUFSIZE);
-                    break;
-                case MegaApi::STATE_SYNCING:
-                    strncpy(out, RESPONSE_SYNCING, BUFSIZE);
-                    break;
-                case MegaApi::STATE_PENDING:
-                    strncpy(out, RESPONSE_PENDING, BUFSIZE);
-                    break;
-                case MegaApi::STATE_NONE:
-                case MegaApi::STATE_IGNORED:
-                default:
-                    strncpy(out, RESPONSE_DEFAULT, BUFSIZE);
-            }
-            break;
-        }
         case 'E':
         {
             if (!uploadQueue.isEmpty())
@@ -269,3 +405,23 @@ const char *ExtServer::GetAnswerToRequest(const char *buf)
 
     return out;
 }
+
+// runs in the resolver thread
+void PathStateResolver::resolve(int requestId, QByteArray request)
+{
+    QByteArray content = request.mid(2);
+    if (request.startsWith(OP_BATCH_PATH_STATE))
+    {
+        emit resolved(requestId, ExtServer::GetAnswerToBatchRequest(content));
+    }
+    else
+    {
+        emit resolved(requestId, QByteArray(ExtServer::getPathStateResponse(content.constData())));
+    }
+}
+
+// runs in the resolver thread
+void PathStateResolver::resolvePath(QString path)
+{
+    emit pathResolved(path, QByteArray(ExtServer::getPathStateResponse(path.toUtf8().constData())));
+}
@@ -1,6 +1,8 @@
 #ifndef EXTSERVER_H
 #define EXTSERVER_H
 
+#include <QThread>
+
 #include "MegaApplication.h"
 #include "megaapi.h"
 #include "control/Preferences.h"
@@ -12,6 +14,20 @@ typedef enum {
    STRING_SEND = 3
 } StringID;
 
+// Resolves path states outside of the GUI thread
+class PathStateResolver: public QObject
+{
+    Q_OBJECT
+
+ public Q_SLOTS:
+    void resolve(int requestId, QByteArray request);
+    void resolvePath(QString path);
+
+ signals:
+    void resolved(int requestId, QByteArray answer);
+    void pathResolved(QString path, QByteArray state);
+};
+
 class ExtServer: public QObject
 {
     Q_OBJECT
@@ -19,6 +35,10 @@ class ExtServer: public QObject
  public:
     ExtServer(MegaApplication *app);
     virtual ~ExtServer();
+    static const char *getPathStateResponse(const char *path);
+    static QByteArray GetAnswerToBatchRequest(const QByteArray &content);
+    // shared with NotifyServer, so no path state is resolved in the GUI thread
+    PathStateResolver *getPathStateResolver() const;
 
  protected:
     QLocalServer *m_localServer;
@@ -29,14 +49,34 @@ class ExtServer: public QObject
     void acceptConnection();
     void onClientData();
     void onClientDisconnected();
+    void onPathStateResolved(int requestId, QByteArray answer);
+
  private:
+    // answers are sent in the same order the requests were received
+    struct PendingAnswer
+    {
+        int requestId;
+        bool ready;
+        QByteArray data;
+    };
+
+    void processRequest(QLocalSocket *client, const QByteArray &request);
+    void sendReadyAnswers(QLocalSocket *client);
+    QByteArray GetAnswerToRequest(const QByteArray &request);
+
     QString sockPath;
     QList<QLocalSocket *> m_clients;
-    const char *GetAnswerToRequest(const char *buf);
+    QHash<QLocalSocket *, QByteArray> m_pendingData;
+    QHash<QLocalSocket *, QList<PendingAnswer> > m_pendingAnswers;
+    QHash<int, QLocalSocket *> m_requestOwners;
+    int nextRequestId;
+    QThread *resolverThread;
+    PathStateResolver *resolver;
 
  signals:
     void newUploadQueue(QQueue<QString> uploadQueue);
     void newExportQueue(QQueue<QString> exportQueue);
+    void resolvePathState(int requestId, QByteArray request);
 };
 
 #endif
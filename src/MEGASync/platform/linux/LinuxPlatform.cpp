@@ -94,23 +94,24 @@ void LinuxPlatform::startShellDispatcher(MegaApplication *receiver)
 
     if (!notify_server)
     {
-        notify_server = new NotifyServer();
+        notify_server = new NotifyServer(ext_server->getPathStateResolver());
     }
 }
 
 void LinuxPlatform::stopShellDispatcher()
 {
-    if (ext_server)
-    {
-        delete ext_server;
-        ext_server = NULL;
-    }
-
+    // the notify server uses the resolver of the ext server
     if (notify_server)
     {
         delete notify_server;
         notify_server = NULL;
     }
+
+    if (ext_server)
+    {
+        delete ext_server;
+        ext_server = NULL;
+    }
 }
 
 void LinuxPlatform::syncFolderAdded(QString syncPath, QString syncName, QString syncID)
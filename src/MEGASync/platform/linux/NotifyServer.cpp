@@ -3,11 +3,13 @@
 #include <pwd.h>
 #include <unistd.h>
 #include "control/Utilities.h"
+#include "ExtServer.h"
 
 using namespace mega;
 
-NotifyServer::NotifyServer(): QObject(),
-    m_localServer(0)
+NotifyServer::NotifyServer(PathStateResolver *resolver): QObject(),
+    m_localServer(0),
+    m_resolver(resolver)
 {
     // construct local socket path
     sockPath = MegaApplication::applicationDataPath() + QDir::separator() + QString::fromAscii("notify.socket");
@@ -27,6 +29,12 @@ NotifyServer::NotifyServer(): QObject(),
     }
 
     connect(this, SIGNAL(sendToAll(const char *, QString )), this, SLOT(doSendToAll(const char *, QString)));
+    connect(this, SIGNAL(itemChanged(QString)), this, SLOT(doNotifyItemChange(QString)));
+    if (m_resolver)
+    {
+        connect(this, SIGNAL(resolvePath(QString)), m_resolver, SLOT(resolvePath(QString)), Qt::QueuedConnection);
+        connect(m_resolver, SIGNAL(pathResolved(QString, QByteArray)), this, SLOT(onPathResolved(QString, QByteArray)), Qt::QueuedConnection);
+    }
     connect(m_localServer, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
 }
 
@@ -51,6 +59,7 @@ void NotifyServer::acceptConnection()
         }
 
         connect(client, SIGNAL(disconnected()), this, SLOT(onClientDisconnected()));
+        connect(client, SIGNAL(readyRead()), this, SLOT(onClientData()));
 
         // send the list of current synced folders to the new client
         int localFolders = 0;
@@ -88,6 +97,7 @@ void NotifyServer::onClientDisconnected()
     if (!client)
         return;
     m_clients.removeAll(client);
+    m_subscriptions.remove(client);
     client->deleteLater();
 
     //LOG_debug << "Client disconnected";
@@ -105,9 +115,125 @@ void NotifyServer::doSendToAll(const char *type, QString str)
         }
 }
 
+// clients send one command per line:
+// S<folder> to receive the state of the items changed inside that folder
+// U<folder> to stop receiving them
+void NotifyServer::onClientData()
+{
+    QLocalSocket *client = qobject_cast<QLocalSocket *>(sender());
+    if (!client)
+        return;
+
+    while (client->canReadLine())
+    {
+        QByteArray line = client->readLine();
+        line.chop(1);
+        if (line.size() < 2)
+        {
+            continue;
+        }
+
+        QString folder = QString::fromUtf8(line.constData() + 1, line.size() - 1);
+        switch (line.at(0))
+        {
+            case 'S':
+                m_subscriptions[client].insert(folder);
+                break;
+            case 'U':
+            {
+                QHash<QLocalSocket *, QSet<QString> >::iterator it = m_subscriptions.find(client);
+                if (it != m_subscriptions.end())
+                {
+                    it.value().remove(folder);
+                    if (it.value().isEmpty())
+                    {
+                        m_subscriptions.erase(it);
+                    }
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+// clients subscribed to the folder of the item receive N<state><path> once the
+// resolver thread has the new state, the rest of them receive P<path> and have
+// to ask for it
+void NotifyServer::doNotifyItemChange(QString path)
+{
+    if (m_subscriptions.isEmpty() || !m_resolver)
+    {
+        doSendToAll("P", path);
+        return;
+    }
+
+    QString folder = parentFolder(path);
+    QByteArray utf8Path = path.toUtf8();
+    bool subscribed = false;
+
+    foreach(QLocalSocket *socket, m_clients)
+    {
+        if (!socket || socket->state() != QLocalSocket::ConnectedState)
+        {
+            continue;
+        }
+
+        QHash<QLocalSocket *, QSet<QString> >::const_iterator it = m_subscriptions.constFind(socket);
+        if (it != m_subscriptions.constEnd() && it.value().contains(folder))
+        {
+            subscribed = true;
+            continue;
+        }
+
+        socket->write("P");
+        socket->write(utf8Path.constData());
+        socket->write("\n");
+        socket->flush();
+    }
+
+    if (subscribed)
+    {
+        emit resolvePath(path);
+    }
+}
+
+void NotifyServer::onPathResolved(QString path, QByteArray state)
+{
+    // clients subscribed to the folder right now, they could have changed meanwhile
+    QString folder = parentFolder(path);
+    QByteArray utf8Path = path.toUtf8();
+
+    foreach(QLocalSocket *socket, m_clients)
+    {
+        if (!socket || socket->state() != QLocalSocket::ConnectedState)
+        {
+            continue;
+        }
+
+        QHash<QLocalSocket *, QSet<QString> >::const_iterator it = m_subscriptions.constFind(socket);
+        if (it == m_subscriptions.constEnd() || !it.value().contains(folder))
+        {
+            continue;
+        }
+
+        socket->write("N");
+        socket->write(state);
+        socket->write(utf8Path.constData());
+        socket->write("\n");
+        socket->flush();
+    }
+}
+
+QString NotifyServer::parentFolder(const QString &path)
+{
+    return path.left(path.lastIndexOf(QChar::fromAscii('/')));
+}
+
 void NotifyServer::notifyItemChange(QString path)
 {
-    emit sendToAll("P", path);
+    emit itemChanged(path);
 }
 
 void NotifyServer::notifySyncAdd(QString path)
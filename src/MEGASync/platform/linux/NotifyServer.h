@@ -5,12 +5,15 @@
 #include "megaapi.h"
 #include "control/Preferences.h"
 
+class PathStateResolver;
+
 class NotifyServer: public QObject
 {
     Q_OBJECT
 
  public:
-    NotifyServer();
+    // resolver can be NULL, then clients are only told that the state changed
+    NotifyServer(PathStateResolver *resolver);
     virtual ~NotifyServer();
     void notifyItemChange(QString path);
     void notifySyncAdd(QString path);
@@ -21,16 +24,26 @@ class NotifyServer: public QObject
 
  public Q_SLOTS:
     void acceptConnection();
+    void onClientData();
     void onClientDisconnected();
     void doSendToAll(const char *type, QString str);
+    void doNotifyItemChange(QString path);
+    void onPathResolved(QString path, QByteArray state);
 
  private:
     MegaApplication *app;
     QString sockPath;
     QList<QLocalSocket *> m_clients;
+    // folders each client is showing, changes inside them are sent with the new state
+    QHash<QLocalSocket *, QSet<QString> > m_subscriptions;
+    PathStateResolver *m_resolver;
+
+    static QString parentFolder(const QString &path);
 
 signals:
     void sendToAll(const char *type, QString str);
+    void itemChanged(QString path);
+    void resolvePath(QString path);
 
 };
 